@@ -0,0 +1,227 @@
+/*
+ * Backtracking.h
+ */
+
+#ifndef BACKTRACKING_H_
+#define BACKTRACKING_H_
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <utility>
+using namespace std;
+
+/*
+ * Generic depth-first backtracking search, optionally run by several threads
+ * with work stealing.
+ *
+ * The problem P is a copyable search state with the following operations:
+ *   bool isSolved();                              // no decision left to make
+ *   int chooseVariable();                         // variable ordering: next variable to decide
+ *   void getValues(int var, vector<int> &values); // value ordering: appends the candidates, in order
+ *   void assign(int var, int value);              // makes a decision, recorded in a trail
+ *   void undo();                                  // reverts the last assign
+ *
+ * Each thread works on its own copy of the state. An idle thread steals the
+ * last untried value of the shallowest branching point of another thread,
+ * and rebuilds that branch by replaying the decisions from the root.
+ */
+template <class P>
+class Backtracking {
+	typedef vector<pair<int, int> > Decisions;
+
+	struct Frame {
+		int var;
+		vector<int> values;
+		size_t next;   // next value to try
+		bool assigned; // values[next - 1] is currently assigned
+	};
+
+	struct Worker {
+		mutex lock;           // guards the frames against thieves
+		Decisions base;       // decisions replayed before the frames
+		vector<Frame> frames;
+	};
+
+	int numThreads;
+	const P *root;
+	unique_ptr<P> solution;
+	mutex solutionLock;
+	atomic<bool> found;
+	atomic<int> busy;
+	vector<Worker> workers;
+
+	void run(int id);
+	void explore(Worker &w);
+	bool steal(int thief, Decisions &task);
+public:
+	Backtracking(int numThreads = 1);
+
+	/**
+	 * Searches a solution from state "p". On success, "p" is replaced by
+	 * the solution found; otherwise it is left unchanged.
+	 */
+	bool solve(P &p);
+};
+
+
+template <class P>
+Backtracking<P>::Backtracking(int numThreads) : numThreads(numThreads < 1 ? 1 : numThreads), root(NULL) {}
+
+template <class P>
+bool Backtracking<P>::solve(P &p)
+{
+	if (p.isSolved())
+		return true;
+
+	root = &p;
+	found = false;
+	busy = 1; // the root task, given to worker 0
+	vector<Worker>(numThreads).swap(workers);
+
+	vector<thread> threads;
+	for (int i = 1; i < numThreads; i++)
+		threads.push_back(thread(&Backtracking<P>::run, this, i));
+	run(0);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	if (found)
+		p = *solution;
+	return found;
+}
+
+/**
+ * Worker loop: explores its task, then keeps stealing work until a solution
+ * is found or every worker is idle.
+ */
+template <class P>
+void Backtracking<P>::run(int id)
+{
+	Worker &w = workers[id];
+	bool hasTask = id == 0;
+	while (!found)
+	{
+		if (hasTask)
+		{
+			explore(w);
+			busy--;
+		}
+		hasTask = steal(id, w.base);
+		if (!hasTask)
+		{
+			if (busy == 0)
+				return;
+			this_thread::yield();
+		}
+	}
+}
+
+/**
+ * Depth-first search below the decisions in w.base.
+ */
+template <class P>
+void Backtracking<P>::explore(Worker &w)
+{
+	P state(*root);
+	for (size_t i = 0; i < w.base.size(); i++)
+		state.assign(w.base[i].first, w.base[i].second);
+
+	Frame frame;
+	frame.next = 0;
+	frame.assigned = false;
+	if (state.isSolved())
+	{
+		lock_guard<mutex> guard(solutionLock);
+		if (!found)
+			solution.reset(new P(state));
+		found = true;
+		return;
+	}
+	frame.var = state.chooseVariable();
+	frame.values.clear();
+	state.getValues(frame.var, frame.values);
+	{
+		lock_guard<mutex> guard(w.lock);
+		w.frames.push_back(frame);
+	}
+
+	while (!found)
+	{
+		Frame &f = w.frames.back();
+		if (f.assigned)
+		{
+			state.undo();
+			f.assigned = false;
+		}
+
+		int value;
+		{
+			lock_guard<mutex> guard(w.lock);
+			if (f.next == f.values.size())
+			{
+				w.frames.pop_back();
+				if (w.frames.empty())
+					return;
+				continue;
+			}
+			value = f.values[f.next++];
+		}
+		state.assign(f.var, value);
+		f.assigned = true;
+
+		if (state.isSolved())
+		{
+			lock_guard<mutex> guard(solutionLock);
+			if (!found)
+				solution.reset(new P(state));
+			found = true;
+			break;
+		}
+		frame.var = state.chooseVariable();
+		frame.values.clear();
+		state.getValues(frame.var, frame.values);
+		if (!frame.values.empty())
+		{
+			lock_guard<mutex> guard(w.lock);
+			w.frames.push_back(frame);
+		}
+	}
+
+	lock_guard<mutex> guard(w.lock);
+	w.frames.clear();
+}
+
+/**
+ * Takes the last untried value of the shallowest frame of some other worker.
+ * The stolen branch becomes "task": the victim's decisions down to that frame,
+ * followed by the stolen value.
+ */
+template <class P>
+bool Backtracking<P>::steal(int thief, Decisions &task)
+{
+	for (int k = 1; k < numThreads; k++)
+	{
+		Worker &victim = workers[(thief + k) % numThreads];
+		lock_guard<mutex> guard(victim.lock);
+		for (size_t i = 0; i < victim.frames.size(); i++)
+		{
+			Frame &f = victim.frames[i];
+			if (f.next < f.values.size())
+			{
+				task = victim.base;
+				for (size_t j = 0; j < i; j++)
+					task.push_back(make_pair(victim.frames[j].var, victim.frames[j].values[victim.frames[j].next - 1]));
+				task.push_back(make_pair(f.var, f.values.back()));
+				f.values.pop_back();
+				busy++;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+#endif /* BACKTRACKING_H_ */
@@ -5,43 +5,354 @@
 #include "Labirinth.h"
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "Backtracking.h"
 using namespace std;
 
+// Moves to the neighbouring cells: right, down, left, up
+static const int dx[4] = {0, 1, 0, -1};
+static const int dy[4] = {1, 0, -1, 0};
 
 
-Labirinth::Labirinth(int values[10][10])
+Labirinth::Labirinth(int values[10][10]) : rows(10), cols(10), labirinth(10 * 10), expanded(0)
 {
 	for (int i = 0; i < 10; i++)
 		for (int j = 0; j < 10; j++)
-			labirinth[i][j] = values[i][j];
+		{
+			labirinth[index(i, j)] = values[i][j];
+			if (values[i][j] == 2)
+				goals.push_back(index(i, j));
+		}
+	initializeFreeCells();
 }
 
 
-void Labirinth::initializeVisited()
+Labirinth::Labirinth(int rows, int cols, const vector<int> &values)
+		: rows(rows), cols(cols), labirinth(values), expanded(0)
 {
-	for (int i = 0; i < 10; i++)
-		for (int j = 0; j < 10; j++)
-			visited[i][j] = false;
+	for (int i = 0; i < rows * cols; i++)
+		if (labirinth[i] == 2)
+			goals.push_back(i);
+	initializeFreeCells();
+}
+
+
+void Labirinth::initializeFreeCells()
+{
+	wordsPerRow = (cols + 63) / 64;
+	freeCells.assign((size_t) rows * wordsPerRow, 0);
+	for (int i = 0; i < rows; i++)
+		for (int j = 0; j < cols; j++)
+			if (labirinth[index(i, j)] != 0)
+				freeCells[(size_t) i * wordsPerRow + j / 64] |= (uint64_t) 1 << (j % 64);
+}
+
+
+int Labirinth::index(int x, int y) const
+{
+	return x * cols + y;
+}
+
+
+bool Labirinth::isFree(int x, int y) const
+{
+	return x >= 0 && x < rows && y >= 0 && y < cols && labirinth[index(x, y)] != 0;
+}
+
+
+int Labirinth::getRows() const
+{
+	return rows;
+}
+
+
+int Labirinth::getCols() const
+{
+	return cols;
+}
+
+
+int Labirinth::getCell(int x, int y) const
+{
+	return labirinth[index(x, y)];
+}
+
+
+const vector<int> &Labirinth::getGoals() const
+{
+	return goals;
 }
 
 
+int Labirinth::getNodesExpanded() const
+{
+	return expanded;
+}
+
+
+void Labirinth::setCell(int x, int y, int value)
+{
+	int cell = index(x, y);
+	if (labirinth[cell] == 2)
+		goals.erase(find(goals.begin(), goals.end(), cell));
+	if (value == 2)
+		goals.push_back(cell);
+	labirinth[cell] = value;
+
+	uint64_t bit = (uint64_t) 1 << (y % 64);
+	if (value != 0)
+		freeCells[(size_t) x * wordsPerRow + y / 64] |= bit;
+	else
+		freeCells[(size_t) x * wordsPerRow + y / 64] &= ~bit;
+}
 
 
 void  Labirinth::printLabirinth()
 {
-	for (int i = 0; i < 10; i++)
+	for (int i = 0; i < rows; i++)
 	{
-		for (int j = 0; j < 10; j++)
-			cout << labirinth[i][j] << " ";
+		for (int j = 0; j < cols; j++)
+			cout << labirinth[index(i, j)] << " ";
 
 		cout << endl;
 	}
 }
 
 
-bool Labirinth::findGoal(int x, int y)
+/*
+ * Search state of findGoal for the Backtracking engine: the path walked from
+ * the start cell. The visited marks are shared by all the copies (one per
+ * thread) and are never undone, so every cell is entered only once.
+ */
+class LabirinthSearch {
+	struct Shared {
+		vector<atomic<char> > visited;
+		atomic<int> expanded;
+		Shared(size_t n) : visited(n), expanded(0) {}
+	};
+
+	const vector<int> *cells;
+	int rows, cols;
+	shared_ptr<Shared> shared;
+	vector<int> path;
+public:
+	LabirinthSearch(const vector<int> &cells, int rows, int cols, int start)
+			: cells(&cells), rows(rows), cols(cols), shared(new Shared(cells.size())), path(1, start)
+	{
+		shared->visited[start] = 1;
+		shared->expanded = 1;
+	}
+
+	int getExpanded() const
+	{
+		return shared->expanded;
+	}
+
+	bool isSolved()
+	{
+		return (*cells)[path.back()] == 2;
+	}
+
+	int chooseVariable()
+	{
+		return path.back();
+	}
+
+	void getValues(int cell, vector<int> &values)
+	{
+		int cx = cell / cols, cy = cell % cols;
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = cx + dx[d], ny = cy + dy[d];
+			int n = nx * cols + ny;
+			if (nx >= 0 && nx < rows && ny >= 0 && ny < cols && (*cells)[n] != 0 && !shared->visited[n])
+				values.push_back(n);
+		}
+	}
+
+	void assign(int /*cell*/, int next)
+	{
+		if (!shared->visited[next].exchange(1))
+			shared->expanded++;
+		path.push_back(next);
+	}
+
+	void undo()
+	{
+		path.pop_back();
+	}
+};
+
+
+bool Labirinth::findGoal(int x, int y, int numThreads)
+{
+	expanded = 0;
+	if (!isFree(x, y))
+		return false;
+
+	LabirinthSearch search(labirinth, rows, cols, index(x, y));
+	Backtracking<LabirinthSearch> engine(numThreads);
+	bool found = engine.solve(search);
+	expanded = search.getExpanded();
+	return found;
+}
+
+
+bool Labirinth::findGoalBidirectional(int x, int y)
 {
+	expanded = 0;
+	if (!isFree(x, y))
+		return false;
+	int start = index(x, y);
+	if (labirinth[start] == 2)
+		return true;
+
+	// Frontiers hold cell indices; the backward search starts from every goal
+	vector<int> forward(1, start), backward(goals), next;
+	vector<bool> seenForward(labirinth.size(), false);
+	vector<bool> seenBackward(labirinth.size(), false);
+	seenForward[start] = true;
+	for (size_t i = 0; i < goals.size(); i++)
+		seenBackward[goals[i]] = true;
+
+	while (!forward.empty() && !backward.empty())
+	{
+		bool expandForward = forward.size() <= backward.size();
+		vector<int> &frontier = expandForward ? forward : backward;
+		vector<bool> &seen = expandForward ? seenForward : seenBackward;
+		vector<bool> &seenOther = expandForward ? seenBackward : seenForward;
+
+		next.clear();
+		expanded += frontier.size();
+		for (size_t i = 0; i < frontier.size(); i++)
+		{
+			int cx = frontier[i] / cols, cy = frontier[i] % cols;
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = cx + dx[d], ny = cy + dy[d];
+				if (!isFree(nx, ny))
+					continue;
+				int n = index(nx, ny);
+				if (seenOther[n])
+					return true;
+				if (!seen[n])
+				{
+					seen[n] = true;
+					next.push_back(n);
+				}
+			}
+		}
+		frontier.swap(next);
+	}
 	return false;
 }
 
 
+vector<int> Labirinth::distanceField()
+{
+	vector<int> dist(labirinth.size(), -1);
+	vector<int> queue(goals);
+	expanded = 0;
+	for (size_t i = 0; i < goals.size(); i++)
+		dist[goals[i]] = 0;
+
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		int cell = queue[head];
+		expanded++;
+		int cx = cell / cols, cy = cell % cols;
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = cx + dx[d], ny = cy + dy[d];
+			if (isFree(nx, ny) && dist[index(nx, ny)] == -1)
+			{
+				dist[index(nx, ny)] = dist[cell] + 1;
+				queue.push_back(index(nx, ny));
+			}
+		}
+	}
+	return dist;
+}
+
+
+// Position of the lowest set bit of a non-zero word
+static int lowestBit(uint64_t w)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(w);
+#else
+	int b = 0;
+	while (!(w & 1))
+	{
+		w >>= 1;
+		b++;
+	}
+	return b;
+#endif
+}
+
+
+vector<int> Labirinth::distanceFieldBitParallel()
+{
+	const size_t W = wordsPerRow;
+	vector<int> dist(labirinth.size(), -1);
+	vector<uint64_t> frontier(freeCells.size(), 0);
+	vector<uint64_t> reached(freeCells.size(), 0);
+	vector<uint64_t> next(freeCells.size(), 0);
+	vector<size_t> active, touched; // words of the frontier / words written in next
+	expanded = goals.size();
+
+	for (size_t i = 0; i < goals.size(); i++)
+	{
+		size_t r = goals[i] / cols, c = goals[i] % cols;
+		size_t w = r * W + c / 64;
+		if (frontier[w] == 0)
+			active.push_back(w);
+		frontier[w] |= (uint64_t) 1 << (c % 64);
+		reached[w] |= (uint64_t) 1 << (c % 64);
+		dist[goals[i]] = 0;
+	}
+
+	for (int layer = 1; !active.empty(); layer++)
+	{
+		// Spread each frontier word to its four neighbours, 64 cells at a time
+		touched.clear();
+		for (size_t i = 0; i < active.size(); i++)
+		{
+			size_t w = active[i], col = w % W;
+			uint64_t f = frontier[w];
+			uint64_t spread[5] = {(f << 1) | (f >> 1), f >> 63, f << 63, f, f};
+			size_t target[5] = {w, w + 1, w - 1, w - W, w + W};
+			bool valid[5] = {true, col + 1 < W, col > 0, w >= W, w + W < next.size()};
+			for (int k = 0; k < 5; k++)
+				if (valid[k] && spread[k] != 0)
+				{
+					if (next[target[k]] == 0)
+						touched.push_back(target[k]);
+					next[target[k]] |= spread[k];
+				}
+		}
+
+		// The new layer replaces the frontier; its cells get their distance
+		for (size_t i = 0; i < active.size(); i++)
+			frontier[active[i]] = 0;
+		active.clear();
+		for (size_t i = 0; i < touched.size(); i++)
+		{
+			size_t w = touched[i];
+			uint64_t n = next[w] & freeCells[w] & ~reached[w];
+			next[w] = 0;
+			if (n == 0)
+				continue;
+			frontier[w] = n;
+			reached[w] |= n;
+			active.push_back(w);
+			size_t first = (w / W) * cols + (w % W) * 64;
+			for (; n != 0; n &= n - 1, expanded++)
+				dist[first + lowestBit(n)] = layer;
+		}
+	}
+	return dist;
+}
@@ -6,15 +6,70 @@
 #ifndef LABIRINTH_H_
 #define LABIRINTH_H_
 
+#include <vector>
+#include <cstdint>
+using namespace std;
 
+/*
+ * Cell values: 0 - wall, 1 - free, 2 - goal.
+ * Cells are stored row by row; (x, y) refers to row x, column y.
+ */
 class Labirinth {
-	int labirinth[10][10];
-	bool visited[10][10];
-	void initializeVisited();
+	int rows, cols;
+	vector<int> labirinth;
+	vector<int> goals; // indices of the goal cells
+	int wordsPerRow;
+	vector<uint64_t> freeCells; // one bit per non-wall cell, row by row
+	int expanded;
+	void initializeFreeCells();
+	int index(int x, int y) const;
+	bool isFree(int x, int y) const;
 public:
 	Labirinth(int values[10][10]);
+	Labirinth(int rows, int cols, const vector<int> &values);
+	int getRows() const;
+	int getCols() const;
+	int getCell(int x, int y) const;
+	const vector<int> &getGoals() const;
+
+	/**
+	 * Number of cells expanded by the last search or distance field.
+	 */
+	int getNodesExpanded() const;
+
+	/**
+	 * Changes one cell (e.g. a door opening or closing).
+	 */
+	void setCell(int x, int y, int value);
 	void printLabirinth();
-	bool findGoal(int x, int y);
+
+	/**
+	 * Depth-first search for a goal from (x, y), run on the Backtracking
+	 * engine with numThreads threads.
+	 */
+	bool findGoal(int x, int y, int numThreads = 1);
+
+	/**
+	 * Same answer as findGoal, using a bidirectional breadth-first search
+	 * between (x, y) and the goal cells. Each round expands the smaller
+	 * frontier by one layer and stops as soon as both searches meet.
+	 */
+	bool findGoalBidirectional(int x, int y);
+
+	/**
+	 * Distance (in moves) from every cell to the nearest goal, row by row,
+	 * or -1 for walls and unreachable cells. Queue-based BFS.
+	 */
+	vector<int> distanceField();
+
+	/**
+	 * Same result as distanceField, computed one BFS layer at a time over
+	 * the bit-packed free cells: the frontier advances 64 cells per word
+	 * operation, and only the words next to the current frontier are touched.
+	 * Pays off when the frontier is wide (maze corridors, several goals);
+	 * a lone diagonal wavefront in an open room favours distanceField.
+	 */
+	vector<int> distanceFieldBitParallel();
 };
 
 #endif /* LABIRINTH_H_ */
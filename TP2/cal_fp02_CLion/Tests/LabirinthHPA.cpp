@@ -0,0 +1,376 @@
+/*
+ * LabirinthHPA.cpp
+ */
+
+#include "LabirinthHPA.h"
+
+#include <queue>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+// Moves to the neighbouring cells: right, down, left, up
+static const int dx[4] = {0, 1, 0, -1};
+static const int dy[4] = {1, 0, -1, 0};
+
+// Openings at least this wide get an entrance at each end instead of one in the middle
+static const int WIDE_ENTRANCE = 6;
+
+
+LabirinthHPA::LabirinthHPA(Labirinth &lab, int clusterSize)
+		: lab(lab), rows(lab.getRows()), cols(lab.getCols()), clusterSize(clusterSize), expanded(0)
+{
+	clusterRows = (rows + clusterSize - 1) / clusterSize;
+	clusterCols = (cols + clusterSize - 1) / clusterSize;
+	clusters.resize(clusterRows * clusterCols);
+	downBorders.resize(clusterRows * clusterCols);
+	rightBorders.resize(clusterRows * clusterCols);
+
+	for (int ci = 0; ci < clusterRows; ci++)
+		for (int cj = 0; cj < clusterCols; cj++)
+		{
+			Cluster &c = clusters[ci * clusterCols + cj];
+			c.top = ci * clusterSize;
+			c.left = cj * clusterSize;
+			c.height = min(clusterSize, rows - c.top);
+			c.width = min(clusterSize, cols - c.left);
+			buildDownBorder(ci, cj);
+			buildRightBorder(ci, cj);
+		}
+	for (int ci = 0; ci < clusterRows; ci++)
+		for (int cj = 0; cj < clusterCols; cj++)
+			buildCluster(ci, cj);
+}
+
+
+int LabirinthHPA::clusterOf(int cell) const
+{
+	return (cell / cols) / clusterSize * clusterCols + (cell % cols) / clusterSize;
+}
+
+
+bool LabirinthHPA::isFree(int x, int y) const
+{
+	return lab.getCell(x, y) != 0;
+}
+
+
+/**
+ * Finds the entrances between cluster (ci, cj) and the cluster below it.
+ */
+void LabirinthHPA::buildDownBorder(int ci, int cj)
+{
+	vector<pair<int, int> > &border = downBorders[ci * clusterCols + cj];
+	border.clear();
+	if (ci + 1 >= clusterRows)
+		return;
+
+	const Cluster &c = clusters[ci * clusterCols + cj];
+	int x = c.top + c.height - 1;
+	for (int y = c.left; y < c.left + c.width; y++)
+	{
+		if (!isFree(x, y) || !isFree(x + 1, y))
+			continue;
+		int end = y;
+		while (end + 1 < c.left + c.width && isFree(x, end + 1) && isFree(x + 1, end + 1))
+			end++;
+		if (end - y + 1 >= WIDE_ENTRANCE)
+		{
+			border.push_back(make_pair(x * cols + y, (x + 1) * cols + y));
+			border.push_back(make_pair(x * cols + end, (x + 1) * cols + end));
+		}
+		else
+		{
+			int m = (y + end) / 2;
+			border.push_back(make_pair(x * cols + m, (x + 1) * cols + m));
+		}
+		y = end;
+	}
+}
+
+
+/**
+ * Finds the entrances between cluster (ci, cj) and the cluster on its right.
+ */
+void LabirinthHPA::buildRightBorder(int ci, int cj)
+{
+	vector<pair<int, int> > &border = rightBorders[ci * clusterCols + cj];
+	border.clear();
+	if (cj + 1 >= clusterCols)
+		return;
+
+	const Cluster &c = clusters[ci * clusterCols + cj];
+	int y = c.left + c.width - 1;
+	for (int x = c.top; x < c.top + c.height; x++)
+	{
+		if (!isFree(x, y) || !isFree(x, y + 1))
+			continue;
+		int end = x;
+		while (end + 1 < c.top + c.height && isFree(end + 1, y) && isFree(end + 1, y + 1))
+			end++;
+		if (end - x + 1 >= WIDE_ENTRANCE)
+		{
+			border.push_back(make_pair(x * cols + y, x * cols + y + 1));
+			border.push_back(make_pair(end * cols + y, end * cols + y + 1));
+		}
+		else
+		{
+			int m = (x + end) / 2;
+			border.push_back(make_pair(m * cols + y, m * cols + y + 1));
+		}
+		x = end;
+	}
+}
+
+
+/**
+ * Collects the abstract nodes of cluster (ci, cj) from its four borders and
+ * its goal cells, and computes the distances between them inside the cluster.
+ */
+void LabirinthHPA::buildCluster(int ci, int cj)
+{
+	Cluster &c = clusters[ci * clusterCols + cj];
+	c.nodes.clear();
+	c.links.clear();
+
+	if (ci > 0)
+	{
+		const vector<pair<int, int> > &up = downBorders[(ci - 1) * clusterCols + cj];
+		for (size_t i = 0; i < up.size(); i++)
+			c.links.push_back(make_pair(up[i].second, up[i].first));
+	}
+	if (cj > 0)
+	{
+		const vector<pair<int, int> > &left = rightBorders[ci * clusterCols + cj - 1];
+		for (size_t i = 0; i < left.size(); i++)
+			c.links.push_back(make_pair(left[i].second, left[i].first));
+	}
+	const vector<pair<int, int> > &down = downBorders[ci * clusterCols + cj];
+	c.links.insert(c.links.end(), down.begin(), down.end());
+	const vector<pair<int, int> > &right = rightBorders[ci * clusterCols + cj];
+	c.links.insert(c.links.end(), right.begin(), right.end());
+
+	for (size_t i = 0; i < c.links.size(); i++)
+		if (find(c.nodes.begin(), c.nodes.end(), c.links[i].first) == c.nodes.end())
+			c.nodes.push_back(c.links[i].first);
+	for (int x = c.top; x < c.top + c.height; x++)
+		for (int y = c.left; y < c.left + c.width; y++)
+			if (lab.getCell(x, y) == 2 && find(c.nodes.begin(), c.nodes.end(), x * cols + y) == c.nodes.end())
+				c.nodes.push_back(x * cols + y);
+
+	size_t n = c.nodes.size();
+	c.dist.assign(n * n, -1);
+	vector<int> local;
+	for (size_t i = 0; i < n; i++)
+	{
+		clusterBFS(c, c.nodes[i], local, NULL);
+		for (size_t j = 0; j < n; j++)
+		{
+			int x = c.nodes[j] / cols - c.top, y = c.nodes[j] % cols - c.left;
+			c.dist[i * n + j] = local[x * c.width + y];
+		}
+	}
+}
+
+
+/**
+ * Breadth-first search from "from" that never leaves cluster "c".
+ * Distances (and optionally parents) are indexed by position in the cluster;
+ * -1 means not reachable.
+ */
+void LabirinthHPA::clusterBFS(const Cluster &c, int from, vector<int> &dist, vector<int> *parent) const
+{
+	dist.assign(c.height * c.width, -1);
+	if (parent)
+		parent->assign(c.height * c.width, -1);
+	vector<int> queue(1, (from / cols - c.top) * c.width + from % cols - c.left);
+	dist[queue[0]] = 0;
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		int cur = queue[head];
+		int x = cur / c.width, y = cur % c.width;
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = x + dx[d], ny = y + dy[d];
+			if (nx < 0 || nx >= c.height || ny < 0 || ny >= c.width)
+				continue;
+			int n = nx * c.width + ny;
+			if (dist[n] == -1 && isFree(c.top + nx, c.left + ny))
+			{
+				dist[n] = dist[cur] + 1;
+				if (parent)
+					(*parent)[n] = cur;
+				queue.push_back(n);
+			}
+		}
+	}
+}
+
+
+/**
+ * A* over the abstract graph, from "start" (connected to the nodes of its own
+ * cluster) to the nearest goal. Returns the abstract route and its length.
+ */
+bool LabirinthHPA::abstractSearch(int start, vector<int> &route, int &length)
+{
+	route.clear();
+	expanded = 0;
+	if (!isFree(start / cols, start % cols))
+		return false;
+
+	const vector<int> &goals = lab.getGoals();
+	if (goals.empty())
+		return false;
+
+	// Manhattan distance to the nearest goal
+	auto heuristic = [&](int cell) {
+		int best = -1;
+		for (size_t i = 0; i < goals.size(); i++)
+		{
+			int h = abs(cell / cols - goals[i] / cols) + abs(cell % cols - goals[i] % cols);
+			if (best < 0 || h < best)
+				best = h;
+		}
+		return best;
+	};
+
+	const Cluster &sc = clusters[clusterOf(start)];
+	vector<int> startDist;
+	clusterBFS(sc, start, startDist, NULL);
+
+	unordered_map<int, int> g, parent;
+	unordered_set<int> closed;
+	// Ordered by f, then by larger g (ties go to the node closer to a goal)
+	typedef pair<pair<int, int>, int> Entry;
+	priority_queue<Entry, vector<Entry>, greater<Entry> > open;
+	g[start] = 0;
+	open.push(make_pair(make_pair(heuristic(start), 0), start));
+
+	while (!open.empty())
+	{
+		int u = open.top().second;
+		open.pop();
+		if (!closed.insert(u).second)
+			continue;
+		expanded++;
+		if (lab.getCell(u / cols, u % cols) == 2)
+		{
+			length = g[u];
+			for (int cell = u; cell != start; cell = parent[cell])
+				route.push_back(cell);
+			route.push_back(start);
+			reverse(route.begin(), route.end());
+			return true;
+		}
+
+		auto relax = [&](int v, int cost) {
+			unordered_map<int, int>::iterator it = g.find(v);
+			if (it == g.end() || g[u] + cost < it->second)
+			{
+				g[v] = g[u] + cost;
+				parent[v] = u;
+				open.push(make_pair(make_pair(g[v] + heuristic(v), -g[v]), v));
+			}
+		};
+
+		if (u == start)
+			for (size_t j = 0; j < sc.nodes.size(); j++)
+			{
+				int x = sc.nodes[j] / cols - sc.top, y = sc.nodes[j] % cols - sc.left;
+				if (startDist[x * sc.width + y] > 0)
+					relax(sc.nodes[j], startDist[x * sc.width + y]);
+			}
+
+		const Cluster &c = clusters[clusterOf(u)];
+		size_t k = find(c.nodes.begin(), c.nodes.end(), u) - c.nodes.begin();
+		if (k == c.nodes.size())
+			continue;
+		for (size_t j = 0; j < c.nodes.size(); j++)
+			if (c.dist[k * c.nodes.size() + j] > 0)
+				relax(c.nodes[j], c.dist[k * c.nodes.size() + j]);
+		for (size_t j = 0; j < c.links.size(); j++)
+			if (c.links[j].first == u)
+				relax(c.links[j].second, 1);
+	}
+	return false;
+}
+
+
+void LabirinthHPA::setCell(int x, int y, int value)
+{
+	lab.setCell(x, y, value);
+
+	int ci = x / clusterSize, cj = y / clusterSize;
+	const Cluster &c = clusters[ci * clusterCols + cj];
+	if (x == c.top && ci > 0)
+	{
+		buildDownBorder(ci - 1, cj);
+		buildCluster(ci - 1, cj);
+	}
+	if (x == c.top + c.height - 1 && ci + 1 < clusterRows)
+	{
+		buildDownBorder(ci, cj);
+		buildCluster(ci + 1, cj);
+	}
+	if (y == c.left && cj > 0)
+	{
+		buildRightBorder(ci, cj - 1);
+		buildCluster(ci, cj - 1);
+	}
+	if (y == c.left + c.width - 1 && cj + 1 < clusterCols)
+	{
+		buildRightBorder(ci, cj);
+		buildCluster(ci, cj + 1);
+	}
+	buildCluster(ci, cj);
+}
+
+
+int LabirinthHPA::shortestDistance(int x, int y)
+{
+	vector<int> route;
+	int length;
+	if (!abstractSearch(x * cols + y, route, length))
+		return -1;
+	return length;
+}
+
+
+vector<pair<int, int> > LabirinthHPA::getPath(int x, int y)
+{
+	vector<pair<int, int> > path;
+	vector<int> route;
+	int length;
+	if (!abstractSearch(x * cols + y, route, length))
+		return path;
+
+	// Refine each abstract edge: a step across a border, or a walk inside a cluster
+	path.push_back(make_pair(x, y));
+	vector<int> dist, parent, steps;
+	for (size_t i = 1; i < route.size(); i++)
+	{
+		int a = route[i - 1], b = route[i];
+		if (clusterOf(a) != clusterOf(b))
+		{
+			path.push_back(make_pair(b / cols, b % cols));
+			continue;
+		}
+		const Cluster &c = clusters[clusterOf(a)];
+		clusterBFS(c, a, dist, &parent);
+		steps.clear();
+		int from = (a / cols - c.top) * c.width + a % cols - c.left;
+		for (int cur = (b / cols - c.top) * c.width + b % cols - c.left; cur != from; cur = parent[cur])
+			steps.push_back(cur);
+		for (size_t j = steps.size(); j-- > 0; )
+			path.push_back(make_pair(c.top + steps[j] / c.width, c.left + steps[j] % c.width));
+	}
+	return path;
+}
+
+
+int LabirinthHPA::getNodesExpanded() const
+{
+	return expanded;
+}
@@ -0,0 +1,76 @@
+/*
+ * LabirinthHPA.h
+ */
+
+#ifndef LABIRINTHHPA_H_
+#define LABIRINTHHPA_H_
+
+#include <vector>
+#include <utility>
+#include "Labirinth.h"
+using namespace std;
+
+/*
+ * Hierarchical path finding (HPA*) over a Labirinth.
+ * The grid is cut into square clusters. Each maximal opening between two
+ * neighbouring clusters gets one or two entrance cells, and the distances
+ * between the entrances (and goals) inside each cluster are precomputed.
+ * Queries search this small abstract graph and only refine the clusters on
+ * the chosen route. Paths stay inside the clusters they cross, so they are
+ * near-optimal rather than always the shortest.
+ */
+class LabirinthHPA {
+	struct Cluster {
+		int top, left, height, width;
+		vector<int> nodes;             // cells of the abstract nodes (entrances and goals)
+		vector<pair<int, int> > links; // (entrance cell, cell across the border)
+		vector<int> dist;              // distances between nodes, nodes.size() squared
+	};
+
+	Labirinth &lab;
+	int rows, cols, clusterSize;
+	int clusterRows, clusterCols;
+	vector<Cluster> clusters;
+	vector<vector<pair<int, int> > > downBorders;  // entrances to the cluster below
+	vector<vector<pair<int, int> > > rightBorders; // entrances to the cluster on the right
+	int expanded;
+
+	int clusterOf(int cell) const;
+	bool isFree(int x, int y) const;
+	void buildDownBorder(int ci, int cj);
+	void buildRightBorder(int ci, int cj);
+	void buildCluster(int ci, int cj);
+	void clusterBFS(const Cluster &c, int from, vector<int> &dist, vector<int> *parent) const;
+	bool abstractSearch(int start, vector<int> &route, int &length);
+public:
+	/**
+	 * Builds the abstract graph of "lab", which must outlive this object
+	 * and be changed only through setCell below.
+	 */
+	LabirinthHPA(Labirinth &lab, int clusterSize = 16);
+
+	/**
+	 * Changes a cell and rebuilds the abstract edges of its cluster
+	 * (and of the neighbouring cluster when the cell lies on a shared border).
+	 */
+	void setCell(int x, int y, int value);
+
+	/**
+	 * Length of the hierarchical path from (x, y) to the nearest goal found
+	 * through the abstract graph, or -1 if there is none.
+	 */
+	int shortestDistance(int x, int y);
+
+	/**
+	 * Cells (row, column) of the refined hierarchical path from (x, y)
+	 * to a goal, both included; empty if there is none.
+	 */
+	vector<pair<int, int> > getPath(int x, int y);
+
+	/**
+	 * Number of abstract nodes expanded by the last query.
+	 */
+	int getNodesExpanded() const;
+};
+
+#endif /* LABIRINTHHPA_H_ */
@@ -0,0 +1,193 @@
+/*
+ * LabirinthPlanner.cpp
+ */
+
+#include "LabirinthPlanner.h"
+
+#include <limits>
+#include <cstdlib>
+#include <algorithm>
+
+static const int INF = numeric_limits<int>::max() / 2;
+
+// Moves to the neighbouring cells: right, down, left, up
+static const int dx[4] = {0, 1, 0, -1};
+static const int dy[4] = {1, 0, -1, 0};
+
+
+LabirinthPlanner::LabirinthPlanner(Labirinth &lab, int x, int y)
+		: lab(lab), rows(lab.getRows()), cols(lab.getCols()),
+		  start(x * cols + y), last(x * cols + y), km(0),
+		  g(rows * cols, INF), rhs(rows * cols, INF),
+		  openKey(rows * cols), inOpen(rows * cols, false), expanded(0)
+{
+	for (int i = 0; i < rows; i++)
+		for (int j = 0; j < cols; j++)
+			if (lab.getCell(i, j) == 2)
+				updateVertex(i * cols + j);
+}
+
+
+bool LabirinthPlanner::isFree(int cell) const
+{
+	return lab.getCell(cell / cols, cell % cols) != 0;
+}
+
+
+int LabirinthPlanner::heuristic(int a, int b) const
+{
+	return abs(a / cols - b / cols) + abs(a % cols - b % cols);
+}
+
+
+LabirinthPlanner::Key LabirinthPlanner::calculateKey(int cell) const
+{
+	int best = min(g[cell], rhs[cell]);
+	if (best >= INF)
+		return Key(INF, INF);
+	return Key(best + heuristic(start, cell) + km, best);
+}
+
+
+/**
+ * Recomputes rhs (one step lookahead) of a cell and keeps it in the
+ * open set while it is inconsistent (g != rhs).
+ */
+void LabirinthPlanner::updateVertex(int cell)
+{
+	int x = cell / cols, y = cell % cols;
+	if (lab.getCell(x, y) == 2)
+		rhs[cell] = 0;
+	else
+	{
+		rhs[cell] = INF;
+		if (isFree(cell))
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + dx[d], ny = y + dy[d];
+				if (nx < 0 || nx >= rows || ny < 0 || ny >= cols)
+					continue;
+				int n = nx * cols + ny;
+				if (isFree(n) && g[n] + 1 < rhs[cell])
+					rhs[cell] = g[n] + 1;
+			}
+	}
+
+	if (inOpen[cell])
+	{
+		open.erase(make_pair(openKey[cell], cell));
+		inOpen[cell] = false;
+	}
+	if (g[cell] != rhs[cell])
+	{
+		openKey[cell] = calculateKey(cell);
+		open.insert(make_pair(openKey[cell], cell));
+		inOpen[cell] = true;
+	}
+}
+
+
+void LabirinthPlanner::updateNeighbours(int cell)
+{
+	int x = cell / cols, y = cell % cols;
+	for (int d = 0; d < 4; d++)
+	{
+		int nx = x + dx[d], ny = y + dy[d];
+		if (nx >= 0 && nx < rows && ny >= 0 && ny < cols)
+			updateVertex(nx * cols + ny);
+	}
+}
+
+
+void LabirinthPlanner::computeShortestPath()
+{
+	while (!open.empty() &&
+			(open.begin()->first < calculateKey(start) || rhs[start] != g[start]))
+	{
+		expanded++;
+		Key oldKey = open.begin()->first;
+		int u = open.begin()->second;
+		Key newKey = calculateKey(u);
+		if (oldKey < newKey)
+		{
+			open.erase(open.begin());
+			openKey[u] = newKey;
+			open.insert(make_pair(newKey, u));
+		}
+		else if (g[u] > rhs[u])
+		{
+			open.erase(open.begin());
+			inOpen[u] = false;
+			g[u] = rhs[u];
+			updateNeighbours(u);
+		}
+		else
+		{
+			g[u] = INF;
+			updateVertex(u);
+			updateNeighbours(u);
+		}
+	}
+}
+
+
+void LabirinthPlanner::setCell(int x, int y, int value)
+{
+	if (lab.getCell(x, y) == value)
+		return;
+	lab.setCell(x, y, value);
+	updateVertex(x * cols + y);
+	updateNeighbours(x * cols + y);
+}
+
+
+void LabirinthPlanner::moveStart(int x, int y)
+{
+	start = x * cols + y;
+	km += heuristic(last, start);
+	last = start;
+}
+
+
+int LabirinthPlanner::shortestDistance()
+{
+	expanded = 0;
+	if (!isFree(start))
+		return -1;
+	computeShortestPath();
+	return g[start] >= INF ? -1 : g[start];
+}
+
+
+vector<pair<int, int> > LabirinthPlanner::getPath()
+{
+	vector<pair<int, int> > path;
+	if (shortestDistance() < 0)
+		return path;
+
+	// Each step goes to the neighbour with the smallest g
+	int cell = start;
+	path.push_back(make_pair(cell / cols, cell % cols));
+	while (lab.getCell(cell / cols, cell % cols) != 2)
+	{
+		int x = cell / cols, y = cell % cols, best = -1;
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = x + dx[d], ny = y + dy[d];
+			if (nx < 0 || nx >= rows || ny < 0 || ny >= cols)
+				continue;
+			int n = nx * cols + ny;
+			if (isFree(n) && (best < 0 || g[n] < g[best]))
+				best = n;
+		}
+		cell = best;
+		path.push_back(make_pair(cell / cols, cell % cols));
+	}
+	return path;
+}
+
+
+int LabirinthPlanner::getNodesExpanded() const
+{
+	return expanded;
+}
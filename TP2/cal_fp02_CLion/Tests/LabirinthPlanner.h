@@ -0,0 +1,77 @@
+/*
+ * LabirinthPlanner.h
+ */
+
+#ifndef LABIRINTHPLANNER_H_
+#define LABIRINTHPLANNER_H_
+
+#include <vector>
+#include <set>
+#include <utility>
+#include "Labirinth.h"
+using namespace std;
+
+/*
+ * Incremental shortest path planner (D* Lite) between a start cell and the
+ * nearest goal of a Labirinth whose cells change over time.
+ * The search runs backwards from the goals and keeps its g/rhs values
+ * between queries, so after a batch of cell changes only the part of the
+ * search affected by them is repaired.
+ */
+class LabirinthPlanner {
+	typedef pair<int, int> Key;
+
+	Labirinth &lab;
+	int rows, cols;
+	int start, last; // current start cell, start cell at the last key change
+	int km;          // key modifier, grows when the start moves
+	vector<int> g, rhs;
+	set<pair<Key, int> > open;
+	vector<Key> openKey;  // key of each cell in open
+	vector<bool> inOpen;
+	int expanded;
+
+	bool isFree(int cell) const;
+	int heuristic(int a, int b) const;
+	Key calculateKey(int cell) const;
+	void updateVertex(int cell);
+	void updateNeighbours(int cell);
+	void computeShortestPath();
+public:
+	/**
+	 * Plans from (x, y) to the goals currently in "lab".
+	 * The labirinth must outlive the planner and be changed only
+	 * through setCell below.
+	 */
+	LabirinthPlanner(Labirinth &lab, int x, int y);
+
+	/**
+	 * Changes a cell of the labirinth. Changes are only propagated
+	 * by the next call to shortestDistance or getPath.
+	 */
+	void setCell(int x, int y, int value);
+
+	/**
+	 * Moves the start cell (e.g. the agent walked along the path).
+	 */
+	void moveStart(int x, int y);
+
+	/**
+	 * Number of moves from the start to the nearest goal, or -1 if
+	 * no goal can be reached.
+	 */
+	int shortestDistance();
+
+	/**
+	 * Cells (row, column) of a shortest path from the start to a goal,
+	 * both included; empty if no goal can be reached.
+	 */
+	vector<pair<int, int> > getPath();
+
+	/**
+	 * Number of cells expanded by the last shortestDistance call.
+	 */
+	int getNodesExpanded() const;
+};
+
+#endif /* LABIRINTHPLANNER_H_ */
@@ -0,0 +1,164 @@
+/*
+ * MazeGenerator.cpp
+ */
+
+#include "MazeGenerator.h"
+
+#include <random>
+#include <algorithm>
+
+// Moves to the neighbouring cells: right, down, left, up
+static const int dx[4] = {0, 1, 0, -1};
+static const int dy[4] = {1, 0, -1, 0};
+
+/*
+ * The perfect mazes are carved on the lattice of cells with odd row and
+ * column; lattice cell (i, j) is grid cell (2i + 1, 2j + 1), and the grid
+ * cell between two neighbouring lattice cells is the wall that gets opened.
+ */
+
+static void carve(vector<int> &maze, int cols, int i, int j, int d)
+{
+	maze[(2 * i + 1 + dx[d]) * cols + 2 * j + 1 + dy[d]] = 1;
+	maze[(2 * (i + dx[d]) + 1) * cols + 2 * (j + dy[d]) + 1] = 1;
+}
+
+static void placeLatticeGoal(vector<int> &maze, int rows, int cols)
+{
+	int lr = (rows - 1) / 2, lc = (cols - 1) / 2;
+	maze[(2 * lr - 1) * cols + 2 * lc - 1] = 2;
+}
+
+
+vector<int> generateBacktrackerMaze(int rows, int cols, unsigned seed)
+{
+	mt19937 gen(seed);
+	int lr = (rows - 1) / 2, lc = (cols - 1) / 2;
+	vector<int> maze(rows * cols, 0);
+	vector<bool> visited(lr * lc, false);
+
+	vector<int> stack(1, 0);
+	visited[0] = true;
+	maze[cols + 1] = 1;
+	while (!stack.empty())
+	{
+		int i = stack.back() / lc, j = stack.back() % lc;
+		int options[4], n = 0;
+		for (int d = 0; d < 4; d++)
+		{
+			int ni = i + dx[d], nj = j + dy[d];
+			if (ni >= 0 && ni < lr && nj >= 0 && nj < lc && !visited[ni * lc + nj])
+				options[n++] = d;
+		}
+		if (n == 0)
+		{
+			stack.pop_back();
+			continue;
+		}
+		int d = options[gen() % n];
+		carve(maze, cols, i, j, d);
+		visited[(i + dx[d]) * lc + j + dy[d]] = true;
+		stack.push_back((i + dx[d]) * lc + j + dy[d]);
+	}
+
+	placeLatticeGoal(maze, rows, cols);
+	return maze;
+}
+
+
+vector<int> generatePrimMaze(int rows, int cols, unsigned seed)
+{
+	mt19937 gen(seed);
+	int lr = (rows - 1) / 2, lc = (cols - 1) / 2;
+	vector<int> maze(rows * cols, 0);
+	vector<char> state(lr * lc, 0); // 0 - outside, 1 - frontier, 2 - in the maze
+	vector<int> frontier;
+
+	auto add = [&](int cell) {
+		int i = cell / lc, j = cell % lc;
+		state[cell] = 2;
+		for (int d = 0; d < 4; d++)
+		{
+			int ni = i + dx[d], nj = j + dy[d];
+			if (ni >= 0 && ni < lr && nj >= 0 && nj < lc && state[ni * lc + nj] == 0)
+			{
+				state[ni * lc + nj] = 1;
+				frontier.push_back(ni * lc + nj);
+			}
+		}
+	};
+
+	maze[cols + 1] = 1;
+	add(0);
+	while (!frontier.empty())
+	{
+		size_t k = gen() % frontier.size();
+		int cell = frontier[k];
+		frontier[k] = frontier.back();
+		frontier.pop_back();
+
+		// Join the cell to a random neighbour already in the maze
+		int i = cell / lc, j = cell % lc;
+		int options[4], n = 0;
+		for (int d = 0; d < 4; d++)
+		{
+			int ni = i + dx[d], nj = j + dy[d];
+			if (ni >= 0 && ni < lr && nj >= 0 && nj < lc && state[ni * lc + nj] == 2)
+				options[n++] = (d + 2) % 4;
+		}
+		int d = options[gen() % n];
+		carve(maze, cols, i - dx[d], j - dy[d], d);
+		add(cell);
+	}
+
+	placeLatticeGoal(maze, rows, cols);
+	return maze;
+}
+
+
+vector<int> generateRoomsMaze(int rows, int cols, unsigned seed, int roomSize, double obstacles)
+{
+	mt19937 gen(seed);
+	unsigned threshold = (unsigned) (obstacles * 1000);
+	vector<int> maze(rows * cols, 1);
+
+	for (int x = 0; x < rows; x++)
+		for (int y = 0; y < cols; y++)
+		{
+			if (x == 0 || y == 0 || x == rows - 1 || y == cols - 1 || x % roomSize == 0 || y % roomSize == 0)
+				maze[x * cols + y] = 0;
+			else if (gen() % 1000 < threshold)
+				maze[x * cols + y] = 0;
+		}
+
+	// One door (with the cells on both sides cleared) in every wall between two rooms
+	for (int x = roomSize; x < rows - 1; x += roomSize)
+		for (int a = 1; a < cols - 1; a += roomSize)
+		{
+			int b = min(a + roomSize - 1, cols - 1) - 1;
+			int y = a + gen() % (b - a + 1);
+			for (int k = x - 1; k <= x + 1; k++)
+				if (k < rows - 1)
+					maze[k * cols + y] = 1;
+		}
+	for (int y = roomSize; y < cols - 1; y += roomSize)
+		for (int a = 1; a < rows - 1; a += roomSize)
+		{
+			int b = min(a + roomSize - 1, rows - 1) - 1;
+			int x = a + gen() % (b - a + 1);
+			for (int k = y - 1; k <= y + 1; k++)
+				if (k < cols - 1)
+					maze[x * cols + k] = 1;
+		}
+
+	// Start and goal inside the first and last rooms, clear of obstacles
+	int gx = rows - 2, gy = cols - 2;
+	if (gx % roomSize == 0)
+		gx--;
+	if (gy % roomSize == 0)
+		gy--;
+	maze[cols + 1] = maze[cols + 2] = maze[2 * cols + 1] = 1;
+	maze[gx * cols + gy - 1] = maze[(gx - 1) * cols + gy] = 1;
+	maze[gx * cols + gy] = 2;
+	return maze;
+}
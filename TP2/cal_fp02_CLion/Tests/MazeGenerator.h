@@ -0,0 +1,36 @@
+/*
+ * MazeGenerator.h
+ */
+
+#ifndef MAZEGENERATOR_H_
+#define MAZEGENERATOR_H_
+
+#include <vector>
+using namespace std;
+
+/*
+ * Deterministic maze generators for the Labirinth class.
+ * Each returns rows * cols cell values, row by row (0 - wall, 1 - free,
+ * 2 - goal), surrounded by walls. The start cell (1, 1) is always free and
+ * the goal is placed near the opposite corner. The same seed always gives
+ * the same maze.
+ */
+
+/**
+ * Perfect maze (exactly one path between any two cells), carved by a
+ * depth-first recursive backtracker: long corridors, few branches.
+ */
+vector<int> generateBacktrackerMaze(int rows, int cols, unsigned seed);
+
+/**
+ * Perfect maze carved by randomized Prim: many short dead ends.
+ */
+vector<int> generatePrimMaze(int rows, int cols, unsigned seed);
+
+/**
+ * Open rooms of roomSize x roomSize cells connected by doors, with a
+ * fraction "obstacles" (0 to 1) of their cells turned into walls.
+ */
+vector<int> generateRoomsMaze(int rows, int cols, unsigned seed, int roomSize = 32, double obstacles = 0.2);
+
+#endif /* MAZEGENERATOR_H_ */
@@ -89,12 +89,78 @@ bool Sudoku::isComplete()
 
 
 /**
- * Resolve o Sudoku.
+ * Resolve o Sudoku, usando numThreads threads.
  * Retorna indicao de sucesso ou insucesso (sudoku impossvel).
  */
-bool Sudoku::solve()
+bool Sudoku::solve(int numThreads)
 {
-	return false;
+	Backtracking<Sudoku> search(numThreads);
+	return search.solve(*this);
+}
+
+
+bool Sudoku::isSolved()
+{
+	return isComplete();
+}
+
+
+/**
+ * Escolhe a clula vazia com menos nmeros possveis.
+ */
+int Sudoku::chooseVariable()
+{
+	int best = -1, bestCount = 10;
+	for (int i = 0; i < 9; i++)
+		for (int j = 0; j < 9; j++)
+		{
+			if (numbers[i][j] != 0)
+				continue;
+			int count = 0;
+			for (int n = 1; n <= 9; n++)
+				if (!lineHasNumber[i][n] && !columnHasNumber[j][n] && !block3x3HasNumber[i / 3][j / 3][n])
+					count++;
+			if (count < bestCount)
+			{
+				best = 9 * i + j;
+				bestCount = count;
+			}
+		}
+	return best;
+}
+
+
+void Sudoku::getValues(int var, vector<int> &values)
+{
+	int i = var / 9, j = var % 9;
+	for (int n = 1; n <= 9; n++)
+		if (!lineHasNumber[i][n] && !columnHasNumber[j][n] && !block3x3HasNumber[i / 3][j / 3][n])
+			values.push_back(n);
+}
+
+
+void Sudoku::assign(int var, int value)
+{
+	int i = var / 9, j = var % 9;
+	numbers[i][j] = value;
+	lineHasNumber[i][value] = true;
+	columnHasNumber[j][value] = true;
+	block3x3HasNumber[i / 3][j / 3][value] = true;
+	countFilled++;
+	trail.push_back(var);
+}
+
+
+void Sudoku::undo()
+{
+	int var = trail.back();
+	int i = var / 9, j = var % 9, n = numbers[i][j];
+	numbers[i][j] = 0;
+	lineHasNumber[i][n] = false;
+	columnHasNumber[j][n] = false;
+	block3x3HasNumber[i / 3][j / 3][n] = false;
+	countFilled--;
+	trail.pop_back();
 }
 
 
@@ -12,6 +12,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <vector>
+#include "Backtracking.h"
 using namespace std;
 
 #define IllegalArgumentException -1
@@ -34,6 +36,19 @@ class Sudoku
 
 	void initialize();
 
+	/**
+	 * Operaes usadas pela pesquisa com retrocesso (ver Backtracking.h).
+	 * As variveis so as clulas (9 * linha + coluna), os valores os nmeros de 1 a 9.
+	 * trail - clulas preenchidas pela pesquisa, pela ordem.
+	 */
+	vector<int> trail;
+	bool isSolved();
+	int chooseVariable();
+	void getValues(int var, vector<int> &values);
+	void assign(int var, int value);
+	void undo();
+	friend class Backtracking<Sudoku>;
+
 public:
 	/** Inicia um Sudoku vazio.
 	 */
@@ -62,10 +77,10 @@ public:
 
 
 	/**
-	 * Resolve o Sudoku.
+	 * Resolve o Sudoku, usando numThreads threads.
 	 * Retorna indicao de sucesso ou insucesso (sudoku impossvel).
 	 */
-	bool solve();
+	bool solve(int numThreads = 1);
 
 
 	/**
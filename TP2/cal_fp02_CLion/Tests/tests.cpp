@@ -11,6 +11,9 @@
 
 #include "Sudoku.h"
 #include "Labirinth.h"
+#include "LabirinthPlanner.h"
+#include "LabirinthHPA.h"
+#include "MazeGenerator.h"
 
 using namespace std;
 using testing::Eq;
@@ -301,3 +304,295 @@ TEST(CAL_FP02, testLabirinth) {
 }
 
 
+
+TEST(CAL_FP02, testLabirinthBidirectional) {
+    int lab1[10][10] ={
+            {0,0,0,0,0,0,0,0,0,0},
+            {0,1,1,1,1,1,0,1,0,0},
+            {0,1,0,0,0,1,0,1,0,0},
+            {0,1,1,0,1,1,1,1,1,0},
+            {0,1,0,0,0,1,0,0,0,0},
+            {0,1,0,1,0,1,1,1,1,0},
+            {0,1,1,1,0,0,1,0,1,0},
+            {0,1,0,0,0,0,1,0,1,0},
+            {0,1,1,1,0,0,1,2,0,0},
+            {0,0,0,0,0,0,0,0,0,0}};
+
+    int lab2[10][10] ={
+            {0,0,0,0,0,0,0,0,0,0},
+            {0,1,1,1,1,1,0,1,0,0},
+            {0,1,0,0,0,1,0,1,0,0},
+            {0,1,1,0,1,1,1,1,1,0},
+            {0,1,0,0,0,1,0,0,0,0},
+            {0,1,0,1,0,1,1,1,1,0},
+            {0,1,1,1,0,0,1,0,1,0},
+            {0,1,0,0,0,0,1,0,1,0},
+            {0,1,1,1,0,0,0,2,0,0},
+            {0,0,0,0,0,0,0,0,0,0}};
+
+    Labirinth l1(lab1);
+    EXPECT_EQ(l1.findGoalBidirectional(1, 1),true);
+    EXPECT_EQ(l1.findGoalBidirectional(8, 7),true);
+    EXPECT_EQ(l1.findGoalBidirectional(0, 0),false);
+
+    Labirinth l2(lab2);
+    EXPECT_EQ(l2.findGoalBidirectional(1, 1),false);
+
+    // Open 500x500 room with the goal in the opposite corner,
+    // then closed off by a wall across the whole room
+    int n = 500;
+    vector<int> open(n * n, 1);
+    open[n * n - 1] = 2;
+    Labirinth l3(n, n, open);
+    EXPECT_EQ(l3.findGoalBidirectional(0, 0),true);
+    EXPECT_EQ(l3.findGoal(0, 0),true);
+
+    for (int j = 0; j < n; j++)
+        open[(n / 2) * n + j] = 0;
+    Labirinth l4(n, n, open);
+    EXPECT_EQ(l4.findGoalBidirectional(0, 0),false);
+    EXPECT_EQ(l4.findGoal(0, 0),false);
+}
+
+TEST(CAL_FP02, testLabirinthDistanceField) {
+    int lab1[10][10] ={
+            {0,0,0,0,0,0,0,0,0,0},
+            {0,1,1,1,1,1,0,1,0,0},
+            {0,1,0,0,0,1,0,1,0,0},
+            {0,1,1,0,1,1,1,1,1,0},
+            {0,1,0,0,0,1,0,0,0,0},
+            {0,1,0,1,0,1,1,1,1,0},
+            {0,1,1,1,0,0,1,0,1,0},
+            {0,1,0,0,0,0,1,0,1,0},
+            {0,1,1,1,0,0,1,2,0,0},
+            {0,0,0,0,0,0,0,0,0,0}};
+
+    Labirinth l1(lab1);
+    vector<int> d1 = l1.distanceField();
+    EXPECT_EQ(d1[8 * 10 + 7], 0);
+    EXPECT_EQ(d1[8 * 10 + 6], 1);
+    EXPECT_EQ(d1[1 * 10 + 1], 13);
+    EXPECT_EQ(d1[0], -1);
+    EXPECT_EQ(l1.distanceFieldBitParallel(), d1);
+
+    // Wider than one word per row, with pseudo-random walls and an open
+    // corridor along row 35, so that the frontier crosses the 63|64 and
+    // 127|128 word boundaries
+    int rows = 70, cols = 150;
+    vector<int> values(rows * cols, 1);
+    unsigned seed = 2718;
+    for (int i = 0; i < rows * cols; i++) {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 100 < 30)
+            values[i] = 0;
+    }
+    for (int c = 0; c < cols; c++)
+        values[35 * cols + c] = 1;
+    values[35 * cols + 100] = 2;
+    values[3 * cols + 3] = 2;
+    Labirinth l2(rows, cols, values);
+    vector<int> d2 = l2.distanceField();
+    EXPECT_GT(d2[35 * cols + 0], 0);
+    EXPECT_GT(d2[35 * cols + 149], 0);
+    EXPECT_EQ(l2.distanceFieldBitParallel(), d2);
+}
+
+TEST(CAL_FP02, testLabirinthPlanner) {
+    int lab1[10][10] ={
+            {0,0,0,0,0,0,0,0,0,0},
+            {0,1,1,1,1,1,0,1,0,0},
+            {0,1,0,0,0,1,0,1,0,0},
+            {0,1,1,0,1,1,1,1,1,0},
+            {0,1,0,0,0,1,0,0,0,0},
+            {0,1,0,1,0,1,1,1,1,0},
+            {0,1,1,1,0,0,1,0,1,0},
+            {0,1,0,0,0,0,1,0,1,0},
+            {0,1,1,1,0,0,1,2,0,0},
+            {0,0,0,0,0,0,0,0,0,0}};
+
+    Labirinth l1(lab1);
+    LabirinthPlanner p1(l1, 1, 1);
+    EXPECT_EQ(p1.shortestDistance(), 13);
+    EXPECT_EQ(p1.getPath().size(), 14u);
+
+    // Closing the only door to the goal, then opening another one
+    p1.setCell(8, 6, 0);
+    EXPECT_EQ(p1.shortestDistance(), -1);
+    EXPECT_EQ(p1.getPath().size(), 0u);
+    p1.setCell(7, 7, 1);
+    EXPECT_EQ(p1.shortestDistance(), 13);
+    p1.moveStart(3, 7);
+    EXPECT_EQ(p1.shortestDistance(), 9);
+
+    // Random door toggles, checked against a search from scratch
+    int rows = 60, cols = 80;
+    vector<int> values(rows * cols, 1);
+    unsigned seed = 12345;
+    for (int i = 0; i < rows * cols; i++) {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 100 < 30)
+            values[i] = 0;
+    }
+    values[0] = 1;
+    values[rows * cols - 1] = 2;
+    Labirinth l2(rows, cols, values);
+    LabirinthPlanner p2(l2, 0, 0);
+    for (int k = 0; k < 200; k++) {
+        for (int b = 0; b < 5; b++) {
+            seed = seed * 1103515245 + 12345;
+            int cell = 1 + (seed >> 8) % (rows * cols - 2);
+            p2.setCell(cell / cols, cell % cols, 1 - l2.getCell(cell / cols, cell % cols));
+        }
+        EXPECT_EQ(p2.shortestDistance(), l2.distanceField()[0]);
+        EXPECT_EQ((int) p2.getPath().size() - 1, l2.distanceField()[0] < 0 ? -1 : l2.distanceField()[0]);
+    }
+}
+
+void checkPath(Labirinth &l, int x, int y, vector<pair<int, int> > path, int length)
+{
+    ASSERT_EQ((int) path.size(), length + 1);
+    EXPECT_EQ(path.front(), make_pair(x, y));
+    EXPECT_EQ(l.getCell(path.back().first, path.back().second), 2);
+    for (size_t i = 1; i < path.size(); i++) {
+        EXPECT_EQ(abs(path[i].first - path[i-1].first) + abs(path[i].second - path[i-1].second), 1);
+        EXPECT_NE(l.getCell(path[i].first, path[i].second), 0);
+    }
+}
+
+
+TEST(CAL_FP02, testLabirinthHPA) {
+    int lab1[10][10] ={
+            {0,0,0,0,0,0,0,0,0,0},
+            {0,1,1,1,1,1,0,1,0,0},
+            {0,1,0,0,0,1,0,1,0,0},
+            {0,1,1,0,1,1,1,1,1,0},
+            {0,1,0,0,0,1,0,0,0,0},
+            {0,1,0,1,0,1,1,1,1,0},
+            {0,1,1,1,0,0,1,0,1,0},
+            {0,1,0,0,0,0,1,0,1,0},
+            {0,1,1,1,0,0,1,2,0,0},
+            {0,0,0,0,0,0,0,0,0,0}};
+
+    Labirinth l1(lab1);
+    LabirinthHPA h1(l1, 4);
+    EXPECT_EQ(h1.shortestDistance(1, 1), 13);
+    checkPath(l1, 1, 1, h1.getPath(1, 1), 13);
+    h1.setCell(8, 6, 0);
+    EXPECT_EQ(h1.shortestDistance(1, 1), -1);
+
+    // Same reachability as a full search, paths close to the shortest,
+    // and the same answers after updates as an index built from scratch
+    int rows = 90, cols = 130;
+    vector<int> values(rows * cols, 1);
+    unsigned seed = 4321;
+    for (int i = 0; i < rows * cols; i++) {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 100 < 25)
+            values[i] = 0;
+    }
+    values[rows * cols - 1] = 2;
+    Labirinth l2(rows, cols, values);
+    LabirinthHPA h2(l2, 16);
+    for (int k = 0; k < 8; k++) {
+        seed = seed * 1103515245 + 12345;
+        int cell = (seed >> 8) % (rows * cols - 1);
+        h2.setCell(cell / cols, cell % cols, 1 - l2.getCell(cell / cols, cell % cols));
+
+        vector<int> exact = l2.distanceField();
+        LabirinthHPA fresh(l2, 16);
+        for (int x = 0; x < rows; x += 7)
+            for (int y = 0; y < cols; y += 11) {
+                int d = h2.shortestDistance(x, y);
+                EXPECT_EQ(d, fresh.shortestDistance(x, y));
+                EXPECT_EQ(d < 0, exact[x * cols + y] < 0);
+                EXPECT_GE(d, exact[x * cols + y]);
+                EXPECT_LE(d, exact[x * cols + y] * 3 / 2 + 16);
+                if (d >= 0 && x % 3 == 0)
+                    checkPath(l2, x, y, h2.getPath(x, y), d);
+            }
+    }
+}
+
+TEST(CAL_FP02, testMazeGenerators) {
+    int rows = 101, cols = 151;
+    vector<int> mazes[3] = {generateBacktrackerMaze(rows, cols, 7),
+                            generatePrimMaze(rows, cols, 7),
+                            generateRoomsMaze(rows, cols, 7, 20, 0.2)};
+    EXPECT_EQ(generateBacktrackerMaze(rows, cols, 7), mazes[0]);
+    EXPECT_EQ(generatePrimMaze(rows, cols, 7), mazes[1]);
+    EXPECT_EQ(generateRoomsMaze(rows, cols, 7, 20, 0.2), mazes[2]);
+    EXPECT_NE(generateBacktrackerMaze(rows, cols, 8), mazes[0]);
+
+    for (int k = 0; k < 3; k++) {
+        Labirinth l(rows, cols, mazes[k]);
+        EXPECT_EQ(l.getGoals().size(), 1u);
+        EXPECT_EQ(l.findGoal(1, 1), true);
+        for (int i = 0; i < rows; i++)
+            EXPECT_EQ(l.getCell(i, 0) + l.getCell(i, cols - 1), 0);
+    }
+
+    // Perfect mazes are trees: one edge less than cells, all reachable
+    for (int k = 0; k < 2; k++) {
+        int cells = 0, edges = 0;
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++)
+                if (mazes[k][i * cols + j] != 0) {
+                    cells++;
+                    edges += (mazes[k][(i + 1) * cols + j] != 0) + (mazes[k][i * cols + j + 1] != 0);
+                }
+        EXPECT_EQ(edges, cells - 1);
+        vector<int> dist = Labirinth(rows, cols, mazes[k]).distanceField();
+        EXPECT_EQ(count(dist.begin(), dist.end(), -1), rows * cols - cells);
+    }
+}
+
+TEST(CAL_FP02, testParallelBacktracking) {
+    int in[9][9] =
+            {{1, 0, 0, 0, 0, 7, 0, 0, 0},
+             {0, 7, 0, 0, 6, 0, 8, 0, 0},
+             {2, 0, 0, 0, 4, 0, 6, 0, 0},
+             {7, 6, 4, 0, 0, 0, 9, 0, 0},
+             {0, 0, 0, 0, 2, 0, 5, 6, 0},
+             {0, 0, 0, 0, 0, 0, 0, 0, 0},
+             {0, 1, 0, 0, 3, 0, 0, 0, 0},
+             {4, 0, 0, 1, 0, 0, 0, 0, 5},
+             {0, 5, 0, 0, 0, 4, 0, 9, 0}};
+
+    int out[9][9] =
+            {{1, 4, 6, 8, 5, 7, 2, 3, 9},
+             {3, 7, 9, 2, 6, 1, 8, 5, 4},
+             {2, 8, 5, 9, 4, 3, 6, 7, 1},
+             {7, 6, 4, 3, 1, 5, 9, 2, 8},
+             {8, 3, 1, 4, 2, 9, 5, 6, 7},
+             {5, 9, 2, 6, 7, 8, 4, 1, 3},
+             {9, 1, 8, 5, 3, 2, 7, 4, 6},
+             {4, 2, 7, 1, 9, 6, 3, 8, 5},
+             {6, 5, 3, 7, 8, 4, 1, 9, 2}};
+
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        Sudoku s(in);
+        EXPECT_EQ(s.solve(threads), true);
+        int sout[9][9];
+        int** res = s.getNumbers();
+        for (int i = 0; i < 9; i++)
+            for (int a = 0; a < 9; a++)
+                sout[i][a] = res[i][a];
+        compareSudokus(out, sout);
+    }
+
+    int rows = 301, cols = 301;
+    vector<int> maze = generateBacktrackerMaze(rows, cols, 11);
+    Labirinth l1(rows, cols, maze);
+    EXPECT_EQ(l1.findGoal(1, 1, 4), true);
+    maze[(rows - 2) * cols + cols - 3] = 0;
+    maze[(rows - 3) * cols + cols - 2] = 0;
+    Labirinth l2(rows, cols, maze);
+    EXPECT_EQ(l2.findGoal(1, 1, 4), false);
+    EXPECT_EQ(l2.findGoal(1, 1, 1), false);
+
+    // Every cell reachable from the start is entered exactly once
+    maze[(rows - 2) * cols + cols - 2] = 0;
+    maze[cols + 1] = 2;
+    vector<int> dist = Labirinth(rows, cols, maze).distanceField();
+    EXPECT_EQ(l2.getNodesExpanded(), rows * cols - count(dist.begin(), dist.end(), -1));
+}
@@ -0,0 +1,188 @@
+/*
+ * benchmark.cpp
+ *
+ * Runs every Labirinth search mode on generated mazes and reports the time,
+ * the nodes expanded and the peak memory of each run.
+ * Usage: CAL_FP02_Benchmark [size ...]   (mazes of size x size cells, default 1024 2048 4096)
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "Tests/Labirinth.h"
+#include "Tests/LabirinthPlanner.h"
+#include "Tests/LabirinthHPA.h"
+#include "Tests/MazeGenerator.h"
+
+using namespace std;
+
+static const unsigned SEED = 2020;
+
+struct Measure {
+	double ms;
+	int result;   // 1/0 for found/not found, or the distance (-1 if none)
+	int expanded;
+};
+
+typedef Measure (*MODE_FUNC)(Labirinth &lab);
+
+static double elapsedMs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static Measure runFindGoal(Labirinth &lab)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	bool found = lab.findGoal(1, 1);
+	Measure m = {elapsedMs(start), found, lab.getNodesExpanded()};
+	return m;
+}
+
+static Measure runBidirectional(Labirinth &lab)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	bool found = lab.findGoalBidirectional(1, 1);
+	Measure m = {elapsedMs(start), found, lab.getNodesExpanded()};
+	return m;
+}
+
+static Measure runDistanceField(Labirinth &lab)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int d = lab.distanceField()[lab.getCols() + 1];
+	Measure m = {elapsedMs(start), d, lab.getNodesExpanded()};
+	return m;
+}
+
+static Measure runDistanceFieldBitParallel(Labirinth &lab)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int d = lab.distanceFieldBitParallel()[lab.getCols() + 1];
+	Measure m = {elapsedMs(start), d, lab.getNodesExpanded()};
+	return m;
+}
+
+static Measure runPlanner(Labirinth &lab)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	LabirinthPlanner planner(lab, 1, 1);
+	int d = planner.shortestDistance();
+	Measure m = {elapsedMs(start), d, planner.getNodesExpanded()};
+	return m;
+}
+
+// Closes and reopens the middle cell of the shortest path (an open
+// neighbour of the cell before it, so both replans do real work); only the
+// second replan is timed
+static Measure runPlannerReplan(Labirinth &lab)
+{
+	LabirinthPlanner planner(lab, 1, 1);
+	vector<pair<int, int> > path = planner.getPath();
+	int x = -1, y = -1, value = 0;
+	if (path.size() >= 3)
+	{
+		x = path[path.size() / 2].first;
+		y = path[path.size() / 2].second;
+		value = lab.getCell(x, y);
+		planner.setCell(x, y, 0);
+		planner.shortestDistance();
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if (x >= 0)
+		planner.setCell(x, y, value);
+	int d = planner.shortestDistance();
+	Measure m = {elapsedMs(start), d, planner.getNodesExpanded()};
+	return m;
+}
+
+static Measure runHPABuild(Labirinth &lab)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	LabirinthHPA hpa(lab);
+	Measure m = {elapsedMs(start), 0, 0};
+	return m;
+}
+
+static Measure runHPAQuery(Labirinth &lab)
+{
+	LabirinthHPA hpa(lab);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int d = (int) hpa.getPath(1, 1).size() - 1;
+	Measure m = {elapsedMs(start), d, hpa.getNodesExpanded()};
+	return m;
+}
+
+/**
+ * Peak resident memory of this process, in MB.
+ */
+static double peakMemoryMB()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+	return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+/**
+ * Runs one mode in a child process, so that its peak memory is measured
+ * on its own (the maze, shared with the parent, is included).
+ */
+static void benchmark(const string &maze, int size, Labirinth &lab, MODE_FUNC func, const string &mode)
+{
+	cout.flush();
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		Measure m = func(lab);
+		cout << maze << "; " << size << "; " << mode << "; " << m.ms << "; "
+			 << m.result << "; " << m.expanded << "; " << peakMemoryMB() << endl;
+		_exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		cout << maze << "; " << size << "; " << mode << "; failed" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	vector<int> sizes;
+	for (int i = 1; i < argc; i++)
+		sizes.push_back(atoi(argv[i]));
+	if (sizes.empty())
+		sizes = {1024, 2048, 4096};
+
+	const char *mazes[] = {"backtracker", "prim", "rooms"};
+	cout << "maze; size; mode; time (ms); result; nodes expanded; peak memory (MB)" << endl;
+	for (size_t s = 0; s < sizes.size(); s++)
+		for (int k = 0; k < 3; k++)
+		{
+			int n = sizes[s];
+			vector<int> values = k == 0 ? generateBacktrackerMaze(n, n, SEED)
+					: k == 1 ? generatePrimMaze(n, n, SEED) : generateRoomsMaze(n, n, SEED);
+			Labirinth lab(n, n, values);
+			values.clear();
+			values.shrink_to_fit();
+
+			benchmark(mazes[k], n, lab, runFindGoal, "findGoal");
+			benchmark(mazes[k], n, lab, runBidirectional, "findGoalBidirectional");
+			benchmark(mazes[k], n, lab, runDistanceField, "distanceField");
+			benchmark(mazes[k], n, lab, runDistanceFieldBitParallel, "distanceFieldBitParallel");
+			benchmark(mazes[k], n, lab, runPlanner, "D* Lite plan");
+			benchmark(mazes[k], n, lab, runPlannerReplan, "D* Lite replan");
+			benchmark(mazes[k], n, lab, runHPABuild, "HPA* build");
+			benchmark(mazes[k], n, lab, runHPAQuery, "HPA* query");
+		}
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * ApproxNearestPoints.cpp
+ */
+
+#include "ApproxNearestPoints.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Epsilon of nearestPoints_Approx
+static double approxEpsilon = 0.01;
+// Limits of a grid, per point: cells, and pairs compared within cells
+static const double MAX_CELLS_PER_POINT = 4;
+static const double MAX_PAIRS_PER_POINT = 16;
+// Grids tried before falling back to the exact algorithm
+static const int MAX_ROUNDS = 8;
+
+void setApproxEpsilon(double epsilon)
+{
+	approxEpsilon = epsilon;
+}
+
+double getApproxEpsilon()
+{
+	return approxEpsilon;
+}
+
+/*
+ * Points bucketed by the cells of a grid, with a counting sort: the points
+ * of cell c (row by row) are sorted[start[c]..start[c + 1][.
+ */
+struct CellGrid {
+	double minX, minY, side;
+	int cols, rows;
+	vector<int> start;
+	vector<int> cellOf;
+	vector<Point> sorted;
+	double pairs; // compared within cells
+
+	/**
+	 * Buckets the points in cells of the given side, from (minX, minY).
+	 * Returns false if that takes too many cells.
+	 */
+	bool build(const vector<Point> &vp, double minX, double minY, double width, double height, double side)
+	{
+		int n = vp.size();
+		double c = floor(width / side) + 1, r = floor(height / side) + 1;
+		if (!(c * r <= MAX_CELLS_PER_POINT * n + 16))
+			return false;
+		this->minX = minX;
+		this->minY = minY;
+		this->side = side;
+		cols = (int) c;
+		rows = (int) r;
+
+		start.assign(cols * rows + 1, 0);
+		cellOf.resize(n);
+		for (int i = 0; i < n; i++)
+		{
+			int cx = min(cols - 1, (int) ((vp[i].x - minX) / side));
+			int cy = min(rows - 1, (int) ((vp[i].y - minY) / side));
+			cellOf[i] = cy * cols + cx;
+			start[cellOf[i] + 1]++;
+		}
+		pairs = 0;
+		for (int k = 0; k < cols * rows; k++)
+		{
+			pairs += (double) start[k + 1] * start[k + 1] / 2;
+			start[k + 1] += start[k];
+		}
+		sorted.resize(n);
+		vector<int> next(start.begin(), start.end() - 1);
+		for (int i = 0; i < n; i++)
+			sorted[next[cellOf[i]]++] = vp[i];
+		return true;
+	}
+
+	/**
+	 * Closest pair among the points of the same or neighbouring cells:
+	 * squared distance d2 and indices in "sorted" (d2 infinite if none).
+	 */
+	void scan(double &d2, int &bi, int &bj) const
+	{
+		d2 = numeric_limits<double>::infinity();
+		bi = bj = -1;
+		// Each pair of neighbouring cells is visited once, from the lower one
+		const int dx[] = {1, -1, 0, 1}, dy[] = {0, 1, 1, 1};
+		for (int cy = 0; cy < rows; cy++)
+			for (int cx = 0; cx < cols; cx++)
+			{
+				int c = cy * cols + cx;
+				for (int i = start[c]; i < start[c + 1]; i++)
+				{
+					for (int j = i + 1; j < start[c + 1]; j++)
+						update(i, j, d2, bi, bj);
+					for (int k = 0; k < 4; k++)
+					{
+						int nx = cx + dx[k], ny = cy + dy[k];
+						if (nx < 0 || nx >= cols || ny >= rows)
+							continue;
+						int nc = ny * cols + nx;
+						for (int j = start[nc]; j < start[nc + 1]; j++)
+							update(i, j, d2, bi, bj);
+					}
+				}
+				if (d2 == 0)
+					return;
+			}
+	}
+
+	void update(int i, int j, double &d2, int &bi, int &bj) const
+	{
+		double d = sorted[i].distSquare(sorted[j]);
+		if (d < d2)
+		{
+			d2 = d;
+			bi = i;
+			bj = j;
+		}
+	}
+};
+
+static ApproxResult approxResult(const Result &pair, double lowerBound)
+{
+	ApproxResult res;
+	res.pair = pair;
+	res.lowerBound = lowerBound;
+	return res;
+}
+
+ApproxResult nearestPoints_ApproxBound(vector<Point> &vp, double epsilon)
+{
+	int n = vp.size();
+	if (n < 2)
+		return approxResult(Result(), Result().dmin);
+	double minX = vp[0].x, maxX = minX, minY = vp[0].y, maxY = minY;
+	for (int i = 1; i < n; i++)
+	{
+		minX = min(minX, vp[i].x);
+		maxX = max(maxX, vp[i].x);
+		minY = min(minY, vp[i].y);
+		maxY = max(maxY, vp[i].y);
+	}
+	double width = maxX - minX, height = maxY - minY;
+	if (width == 0 && height == 0)
+		return approxResult(Result(0, vp[0], vp[1]), 0);
+
+	// Cells of about one point (or one per point, if they are on a line)
+	double side = max(sqrt(width * height / n), max(width, height) / n);
+	CellGrid grid;
+	for (int round = 0; round < MAX_ROUNDS; round++)
+	{
+		// Slightly larger cells, so that rounding can't put two points
+		// closer than "side" two cells apart
+		if (!grid.build(vp, minX, minY, width, height, side * (1 + 1e-9)))
+			break;
+		if (grid.pairs > MAX_PAIRS_PER_POINT * n)
+		{
+			side /= 2;
+			continue;
+		}
+		double d2;
+		int i, j;
+		grid.scan(d2, i, j);
+		if (i < 0)
+		{
+			side *= 2; // no pair closer than the side
+			continue;
+		}
+		Result pair(sqrt(d2), grid.sorted[i], grid.sorted[j]);
+		if (pair.dmin <= side)
+			return approxResult(pair, pair.dmin);
+		if (pair.dmin <= (1 + epsilon) * side)
+			return approxResult(pair, side);
+		side = pair.dmin;
+	}
+	Result exact = nearestPoints_DC_Merge(vp);
+	return approxResult(exact, exact.dmin);
+}
+
+Result nearestPoints_Approx(vector<Point> &vp)
+{
+	return nearestPoints_ApproxBound(vp, approxEpsilon).pair;
+}
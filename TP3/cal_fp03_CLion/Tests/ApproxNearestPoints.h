@@ -0,0 +1,46 @@
+/*
+ * ApproxNearestPoints.h
+ */
+
+#ifndef APPROXNEARESTPOINTS_H_
+#define APPROXNEARESTPOINTS_H_
+
+#include <vector>
+#include "NearestPoints.h"
+
+using namespace std;
+
+/*
+ * Answer of the approximate closest pair, with its certificate: the
+ * closest pair of the points is at least lowerBound apart, and the pair
+ * returned is pair.dmin apart, with pair.dmin <= (1 + epsilon) * lowerBound.
+ */
+struct ApproxResult {
+	Result pair;
+	double lowerBound;
+};
+
+/**
+ * Closest pair within a factor 1 + epsilon, in expected linear time.
+ * The points are bucketed by a counting sort in a grid whose cells hold
+ * about one point, and each point is compared with those of its own cell
+ * and of the cells next to it. Every pair closer than the side g of the
+ * cells is then checked, so:
+ *  - if the best pair found is at most g apart, it is the closest pair;
+ *  - otherwise no pair is closer than g, and the answer is accepted if
+ *    it is within 1 + epsilon of g, or the grid is rebuilt with cells as
+ *    large as the best distance.
+ * Cells that get too crowded (clustered points) are halved; if that does
+ * not settle, the answer comes from nearestPoints_DC_Merge (exact).
+ */
+ApproxResult nearestPoints_ApproxBound(vector<Point> &vp, double epsilon);
+
+/**
+ * nearestPoints_ApproxBound with the epsilon set by setApproxEpsilon
+ * (0.01 by default), as a NP_FUNC.
+ */
+Result nearestPoints_Approx(vector<Point> &vp);
+void setApproxEpsilon(double epsilon);
+double getApproxEpsilon();
+
+#endif /* APPROXNEARESTPOINTS_H_ */
@@ -0,0 +1,231 @@
+/*
+ * DynamicNearestPoints.cpp
+ */
+
+#include "DynamicNearestPoints.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Cell coordinates are clamped to this range, so that two fit in a key
+static const int64_t MAX_CELL = ((int64_t) 1 << 31) - 2;
+
+DynamicNearestPoints::DynamicNearestPoints() :
+		side(1), minCx(0), maxCx(-1), minCy(0), maxCy(-1), count(0), builtCount(0), clock(0)
+{
+}
+
+int64_t DynamicNearestPoints::cellOf(double c) const
+{
+	double cell = floor(c / side);
+	if (!(cell > -MAX_CELL))
+		return -MAX_CELL;
+	return cell < MAX_CELL ? (int64_t) cell : MAX_CELL;
+}
+
+uint64_t DynamicNearestPoints::key(int64_t cx, int64_t cy)
+{
+	return ((uint64_t) (cx + MAX_CELL) << 32) | (uint64_t) (cy + MAX_CELL);
+}
+
+void DynamicNearestPoints::addToGrid(int id)
+{
+	int64_t cx = cellOf(entries[id].p.x), cy = cellOf(entries[id].p.y);
+	cells[key(cx, cy)].push_back(id);
+	if (minCx > maxCx)
+	{
+		minCx = maxCx = cx;
+		minCy = maxCy = cy;
+	}
+	minCx = min(minCx, cx);
+	maxCx = max(maxCx, cx);
+	minCy = min(minCy, cy);
+	maxCy = max(maxCy, cy);
+}
+
+void DynamicNearestPoints::removeFromGrid(int id)
+{
+	unordered_map<uint64_t, vector<int> >::iterator it =
+			cells.find(key(cellOf(entries[id].p.x), cellOf(entries[id].p.y)));
+	vector<int> &cell = it->second;
+	*find(cell.begin(), cell.end(), id) = cell.back();
+	cell.pop_back();
+	if (cell.empty())
+		cells.erase(it);
+}
+
+/**
+ * Rebuilds the grid with cells of about one point, from the bounding box
+ * of the points.
+ */
+void DynamicNearestPoints::rebuild()
+{
+	double minX = numeric_limits<double>::infinity(), maxX = -minX, minY = minX, maxY = -minX;
+	for (size_t i = 0; i < entries.size(); i++)
+		if (entries[i].stamp != 0)
+		{
+			minX = min(minX, entries[i].p.x);
+			maxX = max(maxX, entries[i].p.x);
+			minY = min(minY, entries[i].p.y);
+			maxY = max(maxY, entries[i].p.y);
+		}
+	double w = maxX - minX, h = maxY - minY;
+	side = sqrt(w * h / count);
+	if (!(side > 0 && side < numeric_limits<double>::infinity()))
+		side = max(w, h) / count; // all points on a line
+	if (!(side > 0 && side < numeric_limits<double>::infinity()))
+		side = 1;
+
+	cells.clear();
+	minCx = minCy = 0;
+	maxCx = maxCy = -1;
+	for (size_t i = 0; i < entries.size(); i++)
+		if (entries[i].stamp != 0)
+			addToGrid(i);
+	builtCount = count;
+}
+
+/**
+ * Nearest point to p among those inserted before "stamp", searching the
+ * cells ring by ring around p's cell, until the next ring is farther than
+ * the best distance or out of the cells in use. Returns -1 if there is none.
+ */
+int DynamicNearestPoints::nearestBefore(const Point &p, uint64_t stamp, double &dist2) const
+{
+	int best = -1;
+	dist2 = numeric_limits<double>::infinity();
+	int64_t cx = cellOf(p.x), cy = cellOf(p.y);
+	auto visit = [&](int64_t i, int64_t j) {
+		unordered_map<uint64_t, vector<int> >::const_iterator it = cells.find(key(i, j));
+		if (it == cells.end())
+			return;
+		for (size_t k = 0; k < it->second.size(); k++)
+		{
+			const Entry &e = entries[it->second[k]];
+			if (e.stamp >= stamp)
+				continue;
+			double d = p.distSquare(e.p);
+			if (d < dist2)
+			{
+				dist2 = d;
+				best = it->second[k];
+			}
+		}
+	};
+	for (int64_t r = 0; ; r++)
+	{
+		// Points in ring r are farther than r - 1 cells (less some rounding)
+		double gap = (r - 1) * side * (1 - 1e-9);
+		if (r > 0 && gap * gap >= dist2)
+			break;
+		if (cx - r < minCx && cx + r > maxCx && cy - r < minCy && cy + r > maxCy)
+			break;
+		int64_t fromX = max(cx - r, minCx), toX = min(cx + r, maxCx);
+		if (cy - r >= minCy)
+			for (int64_t i = fromX; i <= toX; i++)
+				visit(i, cy - r);
+		if (r > 0 && cy + r <= maxCy)
+			for (int64_t i = fromX; i <= toX; i++)
+				visit(i, cy + r);
+		int64_t fromY = max(cy - r + 1, minCy), toY = min(cy + r - 1, maxCy);
+		if (r > 0 && cx - r >= minCx)
+			for (int64_t j = fromY; j <= toY; j++)
+				visit(cx - r, j);
+		if (r > 0 && cx + r <= maxCx)
+			for (int64_t j = fromY; j <= toY; j++)
+				visit(cx + r, j);
+	}
+	return best;
+}
+
+/**
+ * Links point id to its nearest point inserted before it, if any.
+ */
+void DynamicNearestPoints::setLink(int id)
+{
+	Entry &e = entries[id];
+	e.link = nearestBefore(e.p, e.stamp, e.linkDist2);
+	if (e.link < 0)
+		return;
+	links.insert(make_pair(e.linkDist2, id));
+	linkedBy[e.link].push_back(id);
+}
+
+void DynamicNearestPoints::clearLink(int id)
+{
+	Entry &e = entries[id];
+	if (e.link < 0)
+		return;
+	links.erase(make_pair(e.linkDist2, id));
+	vector<int> &by = linkedBy[e.link];
+	*find(by.begin(), by.end(), id) = by.back();
+	by.pop_back();
+	e.link = -1;
+}
+
+int DynamicNearestPoints::insert(const Point &p)
+{
+	int id;
+	if (freeIds.empty())
+	{
+		id = entries.size();
+		entries.push_back(Entry());
+		linkedBy.push_back(vector<int>());
+	}
+	else
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	Entry &e = entries[id];
+	e.p = p;
+	e.stamp = ++clock;
+	e.link = -1;
+	count++;
+	addToGrid(id);
+	// A new point far out may leave the grid with too many empty cells to search
+	double cellsInUse = (double) (maxCx - minCx + 1) * (maxCy - minCy + 1);
+	if (count > 2 * builtCount || cellsInUse > 4.0 * count + 16)
+		rebuild();
+	setLink(id);
+	return id;
+}
+
+bool DynamicNearestPoints::erase(int id)
+{
+	if (id < 0 || id >= (int) entries.size() || entries[id].stamp == 0)
+		return false;
+	removeFromGrid(id);
+	clearLink(id);
+	entries[id].stamp = 0;
+	count--;
+
+	// The points linked to this one look for another link
+	vector<int> orphans;
+	orphans.swap(linkedBy[id]);
+	for (size_t i = 0; i < orphans.size(); i++)
+	{
+		Entry &e = entries[orphans[i]];
+		links.erase(make_pair(e.linkDist2, orphans[i]));
+		e.link = -1;
+		setLink(orphans[i]);
+	}
+	freeIds.push_back(id);
+	if (count < builtCount / 4)
+		rebuild();
+	return true;
+}
+
+Result DynamicNearestPoints::closest() const
+{
+	if (links.empty())
+		return Result();
+	const Entry &e = entries[links.begin()->second];
+	return Result(sqrt(e.linkDist2), e.p, entries[e.link].p);
+}
+
+int DynamicNearestPoints::size() const
+{
+	return count;
+}
@@ -0,0 +1,79 @@
+/*
+ * DynamicNearestPoints.h
+ */
+
+#ifndef DYNAMICNEARESTPOINTS_H_
+#define DYNAMICNEARESTPOINTS_H_
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <cstdint>
+#include "Point.h"
+#include "NearestPoints.h"
+
+using namespace std;
+
+/*
+ * Set of points that keeps its closest pair up to date as points are
+ * inserted and erased.
+ * Each point keeps its nearest neighbour among the points inserted before
+ * it: the closest pair is then the smallest of these links, and inserting
+ * a point changes no other link. The links are kept in an ordered set (a
+ * heap that allows erasing), and the points in a hash grid, rebuilt with a
+ * cell of about one point whenever the number of points doubles or drops
+ * to a quarter, or the cells spanned get too many for the points. Nearest
+ * neighbours are searched there ring by ring.
+ * For evenly spread points, inserting costs O(log n) expected, and so does
+ * erasing, which only searches again for the points linked to the erased
+ * one (a few, expected, for points inserted in random order).
+ */
+class DynamicNearestPoints {
+	struct Entry {
+		Point p;
+		uint64_t stamp;    // insertion time, 0 if the id is free
+		int link;          // nearest among the points inserted before, -1 if none
+		double linkDist2;  // its squared distance
+	};
+
+	vector<Entry> entries;          // by id
+	vector<int> freeIds;
+	vector<vector<int> > linkedBy;  // ids whose link is each id
+	set<pair<double, int> > links;  // (linkDist2, id) of the points with a link
+	unordered_map<uint64_t, vector<int> > cells;
+	double side;                    // of the grid cells
+	int64_t minCx, maxCx, minCy, maxCy; // range of the cells in use
+	int count, builtCount;          // points now, and when the grid was built
+	uint64_t clock;
+
+	int64_t cellOf(double c) const;
+	static uint64_t key(int64_t cx, int64_t cy);
+	void addToGrid(int id);
+	void removeFromGrid(int id);
+	void rebuild();
+	int nearestBefore(const Point &p, uint64_t stamp, double &dist2) const;
+	void setLink(int id);
+	void clearLink(int id);
+public:
+	DynamicNearestPoints();
+
+	/**
+	 * Adds point p, returning the id that erases it.
+	 */
+	int insert(const Point &p);
+
+	/**
+	 * Removes the point with the given id. Returns false if there is none.
+	 */
+	bool erase(int id);
+
+	/**
+	 * Closest pair of the points in the set (a default Result if there are
+	 * less than two).
+	 */
+	Result closest() const;
+
+	int size() const;
+};
+
+#endif /* DYNAMICNEARESTPOINTS_H_ */
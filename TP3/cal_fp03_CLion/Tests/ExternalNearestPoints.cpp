@@ -0,0 +1,392 @@
+/*
+ * ExternalNearestPoints.cpp
+ */
+
+#include "ExternalNearestPoints.h"
+
+#include <fstream>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <unistd.h>
+#include "PointFile.h"
+#include "NearestPointsCommon.h"
+
+// Smaller budgets are raised to this
+static const size_t MIN_MEMORY_BUDGET = 64 << 10;
+// Smallest buffer of each run being merged, in points
+static const size_t MIN_MERGE_BUFFER = 1024;
+// Most runs merged at once (each one is an open file)
+static const size_t MAX_FAN_IN = 256;
+
+ExternalConfig::ExternalConfig(size_t memoryBudget, const string &tempDir) :
+		memoryBudget(memoryBudget), tempDir(tempDir)
+{
+}
+
+/*
+ * Temporary files, removed when the object is destroyed.
+ */
+class TempFiles {
+	string dir;
+	vector<string> names;
+public:
+	TempFiles(const string &dir) : dir(dir) {}
+
+	~TempFiles()
+	{
+		for (size_t i = 0; i < names.size(); i++)
+			remove(names[i].c_str());
+	}
+
+	bool create(string &name)
+	{
+		string pattern = dir + "/np_runXXXXXX";
+		vector<char> path(pattern.begin(), pattern.end());
+		path.push_back('\0');
+		int fd = mkstemp(path.data());
+		if (fd < 0)
+			return false;
+		close(fd);
+		name = path.data();
+		names.push_back(name);
+		return true;
+	}
+
+	void release(const string &name)
+	{
+		remove(name.c_str());
+		names.erase(find(names.begin(), names.end(), name));
+	}
+};
+
+/**
+ * Reads points [index, index + n[ of a run file (an array of Point).
+ */
+static bool readPoints(ifstream &is, uint64_t index, Point *out, size_t n)
+{
+	is.seekg(index * sizeof(Point));
+	return (bool) is.read(reinterpret_cast<char *>(out), n * sizeof(Point));
+}
+
+/*
+ * Sequential reader of part of a run file, through a buffer.
+ */
+class RunReader {
+	ifstream is;
+	vector<Point> buffer;
+	size_t pos;
+	uint64_t next, end;
+	bool ok;
+public:
+	RunReader(const string &file, uint64_t begin, uint64_t count, size_t bufferPoints) :
+			is(file.c_str(), ios::binary), buffer(max(bufferPoints, (size_t) 1)),
+			pos(buffer.size()), next(begin), end(begin + count), ok((bool) is)
+	{
+	}
+
+	/**
+	 * Reads the next point into p. Returns false at the end or on failure.
+	 */
+	bool read(Point &p)
+	{
+		if (pos == buffer.size())
+		{
+			if (next == end || !ok)
+				return false;
+			size_t n = min((uint64_t) buffer.size(), end - next);
+			buffer.resize(n);
+			ok = readPoints(is, next, buffer.data(), n);
+			next += n;
+			pos = 0;
+			if (!ok)
+				return false;
+		}
+		p = buffer[pos++];
+		return true;
+	}
+
+	bool failed() const
+	{
+		return !ok;
+	}
+};
+
+/**
+ * Reads the point file in runs of runPoints points, sorts each run by X
+ * and writes it to a temporary file.
+ */
+static bool makeRuns(const string &pointFile, const PointFileHeader &header, size_t runPoints,
+		TempFiles &temp, vector<string> &runs)
+{
+	ifstream xs(pointFile.c_str(), ios::binary), ys(pointFile.c_str(), ios::binary);
+	xs.seekg(header.xOffset);
+	ys.seekg(header.yOffset);
+	vector<Point> vp;
+	vector<double> coords;
+	for (uint64_t done = 0; done < header.count; )
+	{
+		size_t n = min((uint64_t) runPoints, header.count - done);
+		vp.resize(n);
+		coords.resize(n);
+		if (!xs.read(reinterpret_cast<char *>(coords.data()), n * sizeof(double)))
+			return false;
+		for (size_t i = 0; i < n; i++)
+			vp[i].x = coords[i];
+		if (!ys.read(reinterpret_cast<char *>(coords.data()), n * sizeof(double)))
+			return false;
+		for (size_t i = 0; i < n; i++)
+			vp[i].y = coords[i];
+		sort(vp.begin(), vp.end(), lessByX<double>);
+
+		string name;
+		if (!temp.create(name))
+			return false;
+		ofstream os(name.c_str(), ios::binary);
+		if (!os.write(reinterpret_cast<const char *>(vp.data()), n * sizeof(Point)) || !os.flush())
+			return false;
+		runs.push_back(name);
+		done += n;
+	}
+	return true;
+}
+
+/**
+ * Merges runs[first..first + count[ by X into the file "out", with a
+ * buffer of bufferPoints points for each input run and for the output.
+ */
+static bool mergeRuns(const vector<string> &runs, size_t first, size_t count, const string &out,
+		size_t bufferPoints)
+{
+	vector<unique_ptr<RunReader> > readers;
+	typedef pair<Point, size_t> Head; // next point of a run, run
+	auto later = [](const Head &a, const Head &b) { return lessByX(b.first, a.first); };
+	priority_queue<Head, vector<Head>, decltype(later)> heads(later);
+	for (size_t r = 0; r < count; r++)
+	{
+		ifstream is(runs[first + r].c_str(), ios::binary | ios::ate);
+		uint64_t points = (uint64_t) is.tellg() / sizeof(Point);
+		readers.push_back(unique_ptr<RunReader>(new RunReader(runs[first + r], 0, points, bufferPoints)));
+		Point p;
+		if (readers[r]->read(p))
+			heads.push(make_pair(p, r));
+	}
+
+	ofstream os(out.c_str(), ios::binary);
+	vector<Point> buffer;
+	buffer.reserve(bufferPoints);
+	while (!heads.empty())
+	{
+		Head h = heads.top();
+		heads.pop();
+		buffer.push_back(h.first);
+		if (buffer.size() == bufferPoints)
+		{
+			os.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(Point));
+			buffer.clear();
+		}
+		Point p;
+		if (readers[h.second]->read(p))
+			heads.push(make_pair(p, h.second));
+	}
+	os.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(Point));
+	for (size_t r = 0; r < count; r++)
+		if (readers[r]->failed())
+			return false;
+	return (bool) os.flush();
+}
+
+/**
+ * Merges the runs, fanIn at a time, until a single one is left.
+ */
+static bool mergeAll(vector<string> &runs, size_t budget, TempFiles &temp)
+{
+	size_t fanIn = min(MAX_FAN_IN, max((size_t) 2, budget / (MIN_MERGE_BUFFER * sizeof(Point)) - 1));
+	while (runs.size() > 1)
+	{
+		vector<string> merged;
+		for (size_t i = 0; i < runs.size(); i += fanIn)
+		{
+			size_t count = min(fanIn, runs.size() - i);
+			if (count == 1)
+			{
+				merged.push_back(runs[i]);
+				continue;
+			}
+			string name;
+			if (!temp.create(name)
+					|| !mergeRuns(runs, i, count, name, budget / ((count + 1) * sizeof(Point))))
+				return false;
+			for (size_t r = i; r < i + count; r++)
+				temp.release(runs[r]);
+			merged.push_back(name);
+		}
+		runs.swap(merged);
+	}
+	return true;
+}
+
+/**
+ * Index of the first point of a file of count points sorted by Y with y
+ * at least "y" (or above "y", if "after"): a binary search, reading one
+ * point per step.
+ */
+static uint64_t firstByY(ifstream &is, uint64_t count, double y, bool after)
+{
+	uint64_t lo = 0, hi = count;
+	while (lo < hi)
+	{
+		uint64_t mid = lo + (hi - lo) / 2;
+		Point p;
+		readPoints(is, mid, &p, 1);
+		if (p.y > y || (!after && p.y == y))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/*
+ * Right strip of a solved slab, in a temporary file sorted by Y.
+ */
+struct RightStrip {
+	string file;
+	uint64_t count;
+	double lastX; // of the slab
+};
+
+/**
+ * Looks up the points of the right strips of previous slabs, whose Y is
+ * within the best distance of the Y range of "strip" (the left strip of
+ * the slab starting at X xb, sorted by Y), in that strip. Right strips
+ * farther than the best distance from xb can't be needed by any later
+ * slab either, and are removed.
+ */
+static bool crossBoundary(vector<RightStrip> &rights, const vector<Point> &strip, double xb,
+		size_t bufferPoints, TempFiles &temp, Closest<double> &best, uint64_t &pointsRead)
+{
+	for (size_t k = 0; k < rights.size(); )
+	{
+		const RightStrip &right = rights[k];
+		if (!within(xb - right.lastX, best.d2))
+		{
+			temp.release(right.file);
+			rights.erase(rights.begin() + k);
+			continue;
+		}
+		k++;
+		if (strip.empty())
+			continue;
+
+		double d = sqrt(best.d2);
+		ifstream is(right.file.c_str(), ios::binary);
+		uint64_t first = firstByY(is, right.count, strip.front().y - d, false);
+		uint64_t last = firstByY(is, right.count, strip.back().y + d, true);
+		RunReader left(right.file, first, last - first, bufferPoints);
+		pointsRead += last - first;
+		Point q;
+		while (left.read(q))
+		{
+			if (!within(xb - q.x, best.d2))
+				continue;
+			d = sqrt(best.d2);
+			size_t j = lower_bound(strip.begin(), strip.end(), q.y - d,
+					[](const Point &p, double y) { return p.y < y; }) - strip.begin();
+			while (j > 0 && within(q.y - strip[j - 1].y, best.d2))
+				j--;
+			for (; j < strip.size() && (strip[j].y <= q.y || within(strip[j].y - q.y, best.d2)); j++)
+				best.update(q, strip[j]);
+		}
+		if (left.failed() || !is)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Solves the slabs of the file sorted by X, and the pairs across their
+ * left boundaries (see nearestPoints_External).
+ */
+static bool solveSlabs(const string &sortedFile, uint64_t count, size_t slabPoints, TempFiles &temp,
+		Closest<double> &best, ExternalStats &stats)
+{
+	ifstream sorted(sortedFile.c_str(), ios::binary);
+	vector<Point> vp, strip;
+	vector<RightStrip> rights;
+	for (uint64_t begin = 0; begin < count; begin += vp.size())
+	{
+		vp.resize(min((uint64_t) slabPoints, count - begin));
+		if (!readPoints(sorted, begin, vp.data(), vp.size()))
+			return false;
+		stats.slabs++;
+		double xb = vp[0].x; // the boundary with the previous slab
+		double lastX = vp.back().x; // vp is sorted by Y once solved
+		if (vp.size() >= 2)
+		{
+			Result r = nearestPoints_DC_Merge_MT(vp);
+			best.update(r.p1, r.p2);
+		}
+		if (best.d2 == 0)
+			break;
+
+		// Left strip of the slab, by Y, against the previous right strips
+		strip.clear();
+		for (size_t i = 0; i < vp.size(); i++)
+			if (within(vp[i].x - xb, best.d2))
+				strip.push_back(vp[i]);
+		sort(strip.begin(), strip.end(), lessByY<double>);
+		if (!crossBoundary(rights, strip, xb, slabPoints, temp, best, stats.boundaryPoints))
+			return false;
+
+		// Right strip of the slab, for the next ones
+		RightStrip right;
+		right.lastX = lastX;
+		strip.clear();
+		for (size_t i = 0; i < vp.size(); i++)
+			if (within(right.lastX - vp[i].x, best.d2))
+				strip.push_back(vp[i]);
+		sort(strip.begin(), strip.end(), lessByY<double>);
+		right.count = strip.size();
+		if (!temp.create(right.file))
+			return false;
+		ofstream os(right.file.c_str(), ios::binary);
+		if (!os.write(reinterpret_cast<const char *>(strip.data()), strip.size() * sizeof(Point)) || !os.flush())
+			return false;
+		rights.push_back(right);
+	}
+	for (size_t k = 0; k < rights.size(); k++)
+		temp.release(rights[k].file);
+	return true;
+}
+
+bool nearestPoints_External(const string &pointFile, Result &res, const ExternalConfig &config,
+		ExternalStats *stats)
+{
+	PointFileHeader header;
+	if (!readPointFileHeader(pointFile, header))
+		return false;
+	size_t budget = max(config.memoryBudget, MIN_MEMORY_BUDGET);
+	TempFiles temp(config.tempDir);
+
+	// Runs: the points and one array of coordinates
+	vector<string> runs;
+	if (!makeRuns(pointFile, header, budget / (sizeof(Point) + sizeof(double)), temp, runs)
+			|| !mergeAll(runs, budget, temp))
+		return false;
+
+	// Slabs: the points, the scratch and strip of nearestPoints_DC_Merge,
+	// the strip across the boundary, and the buffer of the streamed points
+	Closest<double> best;
+	ExternalStats st = ExternalStats();
+	if (!runs.empty() && !solveSlabs(runs[0], header.count, budget / (5 * sizeof(Point)), temp, best, st))
+		return false;
+	res = best.result();
+	if (stats != NULL)
+		*stats = st;
+	return true;
+}
@@ -0,0 +1,60 @@
+/*
+ * ExternalNearestPoints.h
+ */
+
+#ifndef EXTERNALNEARESTPOINTS_H_
+#define EXTERNALNEARESTPOINTS_H_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "NearestPoints.h"
+
+using namespace std;
+
+/*
+ * Configuration of the out-of-core closest pair.
+ */
+struct ExternalConfig {
+	size_t memoryBudget; // bytes of points held in memory at once (at least 64 KB)
+	string tempDir;      // directory of the temporary run files
+	ExternalConfig(size_t memoryBudget = (size_t) 256 << 20, const string &tempDir = ".");
+};
+
+/*
+ * Measures of an out-of-core run.
+ */
+struct ExternalStats {
+	uint64_t slabs;          // solved in memory
+	uint64_t boundaryPoints; // read back by the passes across slab boundaries
+};
+
+/**
+ * Closest pair of the points of a binary point file (see PointFile.h) that
+ * may not fit in memory:
+ *  1. the points are read in memory-sized runs, each sorted by X and
+ *     written to a temporary file, and the runs are merged (as many at a
+ *     time as the budget allows) into a single file sorted by X;
+ *  2. that file is cut in slabs of consecutive points, each solved in
+ *     memory by nearestPoints_DC_Merge_MT (so with the pool of threads set
+ *     by setPoolConfig);
+ *  3. after each slab is solved, its right strip (the points closer in X
+ *     than the best distance d to its last X) is written, sorted by Y, to
+ *     a temporary file;
+ *  4. pairs crossing the left boundary of each slab are found by streaming,
+ *     from the right strips of the previous slabs still within d of the
+ *     boundary, only the points whose Y is within d of the Y range of the
+ *     slab's own left strip, and looking each one up in that strip.
+ * The points of a slab are pairwise at least d apart, and so are the
+ * streamed ones, so each lookup checks a constant number of points. Points
+ * with almost the same X (such as the ConstX sets) keep many right strips
+ * in use, but each boundary only reads the part of them next to its own
+ * strip in Y.
+ * Temporary files are removed before returning. Returns false (res
+ * unchanged) if the point file can't be read or a temporary file can't be
+ * written. Measures are returned in "stats" if not NULL.
+ */
+bool nearestPoints_External(const string &pointFile, Result &res,
+		const ExternalConfig &config = ExternalConfig(), ExternalStats *stats = NULL);
+
+#endif /* EXTERNALNEARESTPOINTS_H_ */
@@ -0,0 +1,235 @@
+/*
+ * KdTree.cpp
+ */
+
+#include "KdTree.h"
+
+#include <algorithm>
+#include "NearestPoints.h"
+
+KdTree::Neighbours::Neighbours(int k, double maxDist)
+{
+	reset(k, maxDist);
+}
+
+void KdTree::Neighbours::reset(int k, double maxDist)
+{
+	this->k = k;
+	bound = maxDist * maxDist;
+	best.clear();
+	best.reserve(k + 1);
+}
+
+void KdTree::Neighbours::add(double d2, int i)
+{
+	if (d2 > bound || (d2 == bound && (int) best.size() == k))
+		return;
+	size_t pos = best.size();
+	best.push_back(make_pair(d2, i));
+	while (pos > 0 && best[pos - 1].first > d2)
+	{
+		best[pos] = best[pos - 1];
+		pos--;
+	}
+	best[pos] = make_pair(d2, i);
+	if ((int) best.size() > k)
+		best.pop_back();
+	if ((int) best.size() == k)
+		bound = best.back().first;
+}
+
+/**
+ * Number of nodes of the tree over n points (the same split rule as build).
+ */
+int KdTree::countNodes(int n, int bucketSize)
+{
+	if (n <= bucketSize)
+		return 1;
+	return 1 + countNodes(n / 2, bucketSize) + countNodes(n - n / 2, bucketSize);
+}
+
+KdTree::KdTree(const vector<Point> &vp, int bucketSize) : bucketSize(max(bucketSize, 1))
+{
+	int n = vp.size();
+	vector<Item> items(n);
+	for (int i = 0; i < n; i++)
+	{
+		items[i].x = vp[i].x;
+		items[i].y = vp[i].y;
+		items[i].index = i;
+	}
+	nodes.resize(countNodes(n, this->bucketSize));
+	build(items, 0, 0, n, getPool(), getPoolConfig().sequentialCutoff);
+
+	points.resize(n);
+	indices.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		points.x()[i] = items[i].x;
+		points.y()[i] = items[i].y;
+		indices[i] = items[i].index;
+	}
+}
+
+/**
+ * Builds the subtree of node "node" over items[begin..end[. Its left child
+ * is node + 1, and its right child follows the whole left subtree.
+ * Subtrees over more than "cutoff" points are built as tasks of "tasks".
+ */
+void KdTree::build(vector<Item> &items, int node, int begin, int end, TaskPool *tasks, int cutoff)
+{
+	Node &nd = nodes[node];
+	nd.begin = begin;
+	nd.end = end;
+	if (end - begin <= bucketSize)
+	{
+		nd.axis = -1;
+		nd.right = -1;
+		return;
+	}
+
+	double minX = items[begin].x, maxX = minX, minY = items[begin].y, maxY = minY;
+	for (int i = begin + 1; i < end; i++)
+	{
+		minX = min(minX, items[i].x);
+		maxX = max(maxX, items[i].x);
+		minY = min(minY, items[i].y);
+		maxY = max(maxY, items[i].y);
+	}
+	nd.axis = maxX - minX >= maxY - minY ? 0 : 1;
+	int middle = begin + (end - begin) / 2;
+	if (nd.axis == 0)
+		nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end,
+				[](const Item &a, const Item &b) { return a.x < b.x; });
+	else
+		nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end,
+				[](const Item &a, const Item &b) { return a.y < b.y; });
+	nd.split = nd.axis == 0 ? items[middle].x : items[middle].y;
+	nd.right = node + 1 + countNodes(middle - begin, bucketSize);
+
+	int right = nd.right;
+	if (end - begin > cutoff)
+		tasks->invoke([&]{ build(items, node + 1, begin, middle, tasks, cutoff); },
+				[&]{ build(items, right, middle, end, tasks, cutoff); });
+	else
+	{
+		build(items, node + 1, begin, middle, tasks, cutoff);
+		build(items, right, middle, end, tasks, cutoff);
+	}
+}
+
+int KdTree::size() const
+{
+	return indices.size();
+}
+
+/**
+ * Searches the subtree of "node", the side of q first, and the other side
+ * only if the split line is within the current bound.
+ */
+void KdTree::search(int node, double x, double y, Neighbours &nb) const
+{
+	const Node &nd = nodes[node];
+	if (nd.axis < 0)
+	{
+		const double *px = points.x(), *py = points.y();
+		for (int i = nd.begin; i < nd.end; i++)
+		{
+			double dx = px[i] - x, dy = py[i] - y;
+			nb.add(dx * dx + dy * dy, i);
+		}
+		return;
+	}
+	double diff = (nd.axis == 0 ? x : y) - nd.split;
+	int nearChild = diff < 0 ? node + 1 : nd.right;
+	int farChild = diff < 0 ? nd.right : node + 1;
+	search(nearChild, x, y, nb);
+	if (diff * diff <= nb.bound)
+		search(farChild, x, y, nb);
+}
+
+/**
+ * Index of the leaf whose region contains (x, y).
+ */
+int KdTree::leafOf(double x, double y) const
+{
+	int node = 0;
+	while (nodes[node].axis >= 0)
+		node = ((nodes[node].axis == 0 ? x : y) < nodes[node].split) ? node + 1 : nodes[node].right;
+	return node;
+}
+
+/**
+ * Writes the k nearest (original indices, padded with -1) to result[0..k[,
+ * using "nb" as scratch.
+ */
+void KdTree::query(double x, double y, int k, double maxDist, Neighbours &nb, int *result) const
+{
+	nb.reset(k, maxDist);
+	if (!nodes.empty() && size() > 0)
+		search(0, x, y, nb);
+	for (int j = 0; j < k; j++)
+		result[j] = j < (int) nb.best.size() ? indices[nb.best[j].second] : -1;
+}
+
+int KdTree::nearest(const Point &q, double maxDist) const
+{
+	int result;
+	Neighbours nb(1, maxDist);
+	query(q.x, q.y, 1, maxDist, nb, &result);
+	return result;
+}
+
+vector<int> KdTree::kNearest(const Point &q, int k, double maxDist) const
+{
+	if (k <= 0)
+		return vector<int>();
+	vector<int> result(k);
+	Neighbours nb(k, maxDist);
+	query(q.x, q.y, k, maxDist, nb, result.data());
+	while (!result.empty() && result.back() < 0)
+		result.pop_back();
+	return result;
+}
+
+/**
+ * Answers the queries order[begin..end[, as tasks of "tasks" while there
+ * are more than "cutoff" of them.
+ */
+void KdTree::queryRange(const vector<Point> &queries, const vector<int> &order, int begin, int end,
+		int k, double maxDist, int *result, TaskPool *tasks, int cutoff) const
+{
+	if (end - begin > cutoff)
+	{
+		int middle = begin + (end - begin) / 2;
+		tasks->invoke([&]{ queryRange(queries, order, begin, middle, k, maxDist, result, tasks, cutoff); },
+				[&]{ queryRange(queries, order, middle, end, k, maxDist, result, tasks, cutoff); });
+		return;
+	}
+	Neighbours nb(k, maxDist);
+	for (int i = begin; i < end; i++)
+	{
+		const Point &q = queries[order[i]];
+		query(q.x, q.y, k, maxDist, nb, result + (size_t) order[i] * k);
+	}
+}
+
+void KdTree::kNearest(const vector<Point> &queries, int k, vector<int> &result, double maxDist) const
+{
+	int n = queries.size();
+	k = max(k, 0);
+	result.assign((size_t) n * k, -1);
+	if (k == 0 || size() == 0)
+		return;
+
+	// Spatial order: by leaf (leaves are numbered in tree order)
+	vector<pair<int, int> > byLeaf(n);
+	for (int i = 0; i < n; i++)
+		byLeaf[i] = make_pair(leafOf(queries[i].x, queries[i].y), i);
+	sort(byLeaf.begin(), byLeaf.end());
+	vector<int> order(n);
+	for (int i = 0; i < n; i++)
+		order[i] = byLeaf[i].second;
+
+	queryRange(queries, order, 0, n, k, maxDist, result.data(), getPool(), getPoolConfig().sequentialCutoff);
+}
@@ -0,0 +1,94 @@
+/*
+ * KdTree.h
+ */
+
+#ifndef KDTREE_H_
+#define KDTREE_H_
+
+#include <vector>
+#include <limits>
+#include "Point.h"
+#include "PointSoA.h"
+#include "TaskPool.h"
+
+using namespace std;
+
+/*
+ * Static 2-d tree over a set of points, for nearest neighbour queries.
+ * Nodes are kept in one flat array (children of node i: i + 1 and "right"),
+ * split at the median of their wider dimension, down to leaves of at most
+ * bucketSize points. The points are stored by leaf, as a PointSoA, so a
+ * leaf is scanned sequentially; distances are computed inline, as
+ * Point::distSquare does, without any virtual call.
+ * Queries return indices into the vector the tree was built from.
+ */
+class KdTree {
+	struct Node {
+		double split;      // internal node: split coordinate
+		int axis;          // 0 - x, 1 - y, -1 - leaf
+		int right;         // internal node: index of the right child
+		int begin, end;    // range of the points below the node
+	};
+
+	struct Item {
+		double x, y;
+		int index;
+	};
+
+	/*
+	 * The k best candidates found so far, by increasing squared distance.
+	 */
+	struct Neighbours {
+		int k;
+		double bound; // squared distance a candidate has to beat
+		vector<pair<double, int> > best;
+		Neighbours(int k, double maxDist);
+		void reset(int k, double maxDist);
+		void add(double d2, int i);
+	};
+
+	vector<Node> nodes;
+	PointSoA points;     // by leaf
+	vector<int> indices; // original index of each stored point
+	int bucketSize;
+
+	static int countNodes(int n, int bucketSize);
+	void build(vector<Item> &items, int node, int begin, int end, TaskPool *tasks, int cutoff);
+	void search(int node, double x, double y, Neighbours &nb) const;
+	int leafOf(double x, double y) const;
+	void query(double x, double y, int k, double maxDist, Neighbours &nb, int *result) const;
+	void queryRange(const vector<Point> &queries, const vector<int> &order, int begin, int end,
+			int k, double maxDist, int *result, TaskPool *tasks, int cutoff) const;
+public:
+	/**
+	 * Builds the tree over the points of vp, in the pool of threads (see
+	 * getPool), down to its sequential cutoff.
+	 */
+	KdTree(const vector<Point> &vp, int bucketSize = 8);
+
+	int size() const;
+
+	/**
+	 * Index of the point closest to q, or -1 if none is at distance
+	 * maxDist or less.
+	 */
+	int nearest(const Point &q, double maxDist = numeric_limits<double>::infinity()) const;
+
+	/**
+	 * Indices of the k points closest to q, closest first, among the points
+	 * at distance maxDist or less (so there may be less than k).
+	 */
+	vector<int> kNearest(const Point &q, int k, double maxDist = numeric_limits<double>::infinity()) const;
+
+	/**
+	 * kNearest for a batch of queries, in parallel in the pool of threads,
+	 * in parts down to its sequential cutoff. Answers are k per query in
+	 * "result" (query i gets result[i * k] to result[i * k + k - 1]),
+	 * padded with -1. The queries are processed sorted by the leaf they
+	 * fall in, so that consecutive queries visit the same nodes.
+	 */
+	void kNearest(const vector<Point> &queries, int k, vector<int> &result,
+			double maxDist = numeric_limits<double>::infinity()) const;
+};
+
+#endif /* KDTREE_H_ */
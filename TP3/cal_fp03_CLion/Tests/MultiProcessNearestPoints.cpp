@@ -0,0 +1,162 @@
+/*
+ * MultiProcessNearestPoints.cpp
+ */
+
+#include "MultiProcessNearestPoints.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "RadixSort.h"
+#include "NearestPointsCommon.h"
+
+/*
+ * Part of the mailbox written by one worker. Its strip goes to the
+ * mailbox's points, from the index of the first point of its slab.
+ */
+struct MailboxSlot {
+	int done;            // set last, once everything else is written
+	int stripPoints;
+	double d2;           // best squared distance in the slab
+	Point p1, p2;
+	double solveMs, totalMs;
+};
+
+static double elapsedMs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Anonymous mapping shared with the processes forked afterwards.
+ */
+static void *sharedMap(size_t bytes)
+{
+	void *p = mmap(NULL, max(bytes, (size_t) 1), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	return p == MAP_FAILED ? NULL : p;
+}
+
+/**
+ * Work of a worker: solves points[begin..end[ (sorted by X) and writes
+ * the result and the boundary strips (unless it is the first or the last
+ * slab) to "slot" and strip[begin..].
+ */
+static void solveSlab(const Point *points, int begin, int end, bool first, bool last,
+		MailboxSlot &slot, Point *strip)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<Point> slab(points + begin, points + end);
+	Result r = nearestPoints_DC_Merge(slab);
+	double d2 = slab.size() < 2 ? numeric_limits<double>::infinity() : r.p1.distSquare(r.p2);
+	slot.solveMs = elapsedMs(start);
+
+	// Left strip, then the rest of the right one
+	int leftEnd = begin;
+	if (!first)
+		while (leftEnd < end && (points[leftEnd].x - points[begin].x) * (points[leftEnd].x - points[begin].x) < d2)
+			leftEnd++;
+	int rightBegin = end;
+	if (!last)
+		while (rightBegin > leftEnd
+				&& (points[end - 1].x - points[rightBegin - 1].x) * (points[end - 1].x - points[rightBegin - 1].x) < d2)
+			rightBegin--;
+	copy(points + begin, points + leftEnd, strip + begin);
+	copy(points + rightBegin, points + end, strip + begin + (leftEnd - begin));
+
+	slot.stripPoints = (leftEnd - begin) + (end - rightBegin);
+	slot.d2 = d2;
+	slot.p1 = r.p1;
+	slot.p2 = r.p2;
+	slot.totalMs = elapsedMs(start);
+	__atomic_store_n(&slot.done, 1, __ATOMIC_RELEASE);
+}
+
+Result nearestPoints_MultiProcess(vector<Point> &vp, int numProcesses, MultiProcessStats *stats)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int n = vp.size();
+	int k = max(1, min(numProcesses, n / 2));
+	MultiProcessStats local;
+	MultiProcessStats &st = stats != NULL ? *stats : local;
+	st.workers.assign(k, WorkerStats());
+	st.bytesDistributed = (size_t) n * sizeof(Point);
+	st.bytesExchanged = 0;
+	st.workersMs = st.mergeMs = 0;
+
+	radixSort<KeyByX<double> >(vp.data(), n, (TaskPool *) NULL);
+	Point *points = static_cast<Point *>(sharedMap(n * sizeof(Point)));
+	size_t mailboxBytes = k * sizeof(MailboxSlot) + (size_t) n * sizeof(Point);
+	void *mailbox = sharedMap(mailboxBytes);
+	if (points == NULL || mailbox == NULL || n < 4)
+	{
+		if (points != NULL)
+			munmap(points, max(n * sizeof(Point), (size_t) 1));
+		if (mailbox != NULL)
+			munmap(mailbox, mailboxBytes);
+		st.workers.clear();
+		st.sortMs = st.totalMs = elapsedMs(start);
+		return nearestPoints_DC_Merge(vp);
+	}
+	copy(vp.begin(), vp.end(), points);
+	mprotect(points, n * sizeof(Point), PROT_READ);
+	MailboxSlot *slots = static_cast<MailboxSlot *>(mailbox);
+	Point *strips = reinterpret_cast<Point *>(slots + k);
+	st.sortMs = elapsedMs(start);
+
+	// Workers
+	chrono::steady_clock::time_point forked = chrono::steady_clock::now();
+	vector<pid_t> pids(k, -1);
+	for (int w = 0; w < k; w++)
+	{
+		pids[w] = fork();
+		if (pids[w] == 0)
+		{
+			solveSlab(points, (long) n * w / k, (long) n * (w + 1) / k, w == 0, w == k - 1, slots[w], strips);
+			_exit(0);
+		}
+	}
+	for (int w = 0; w < k; w++)
+		if (pids[w] > 0)
+			waitpid(pids[w], NULL, 0);
+	st.workersMs = elapsedMs(forked);
+
+	// Coordinator: slabs of failed workers, then all the strips
+	chrono::steady_clock::time_point merging = chrono::steady_clock::now();
+	Result res;
+	double best = numeric_limits<double>::infinity();
+	vector<Point> strip;
+	for (int w = 0; w < k; w++)
+	{
+		int begin = (long) n * w / k, end = (long) n * (w + 1) / k;
+		WorkerStats &ws = st.workers[w];
+		ws.failed = __atomic_load_n(&slots[w].done, __ATOMIC_ACQUIRE) == 0;
+		if (ws.failed)
+			solveSlab(points, begin, end, w == 0, w == k - 1, slots[w], strips);
+		const MailboxSlot &slot = slots[w];
+		ws.points = end - begin;
+		ws.stripPoints = slot.stripPoints;
+		ws.bytesSent = sizeof(MailboxSlot) + slot.stripPoints * sizeof(Point);
+		ws.solveMs = slot.solveMs;
+		ws.totalMs = slot.totalMs;
+		st.bytesExchanged += ws.bytesSent;
+		if (slot.d2 < best)
+		{
+			best = slot.d2;
+			res = Result(sqrt(slot.d2), slot.p1, slot.p2);
+		}
+		strip.insert(strip.end(), strips + begin, strips + begin + slot.stripPoints);
+	}
+	Result across = nearestPoints_DC_Merge(strip);
+	if (strip.size() >= 2 && across.p1.distSquare(across.p2) < best)
+		res = across;
+	st.mergeMs = elapsedMs(merging);
+
+	munmap(points, n * sizeof(Point));
+	munmap(mailbox, mailboxBytes);
+	st.totalMs = elapsedMs(start);
+	return res;
+}
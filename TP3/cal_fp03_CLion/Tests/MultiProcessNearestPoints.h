@@ -0,0 +1,55 @@
+/*
+ * MultiProcessNearestPoints.h
+ */
+
+#ifndef MULTIPROCESSNEARESTPOINTS_H_
+#define MULTIPROCESSNEARESTPOINTS_H_
+
+#include <vector>
+#include <cstddef>
+#include "NearestPoints.h"
+
+using namespace std;
+
+/*
+ * Measures of one worker process.
+ */
+struct WorkerStats {
+	int points;          // in its slab
+	int stripPoints;     // sent to the coordinator
+	size_t bytesSent;    // strip and result, through the mailbox
+	double solveMs;      // solving the slab
+	double totalMs;      // from the start of the worker to its last write
+	bool failed;         // the worker died, and the coordinator solved its slab
+};
+
+/*
+ * Measures of a multi-process run.
+ */
+struct MultiProcessStats {
+	vector<WorkerStats> workers;
+	size_t bytesDistributed; // points shared with the workers (read-only)
+	size_t bytesExchanged;   // sent by all the workers
+	double sortMs;           // sorting and sharing the points
+	double workersMs;        // from the first fork to the last worker done
+	double mergeMs;          // solving the strips, in the coordinator
+	double totalMs;
+};
+
+/**
+ * Closest pair of vp computed by numProcesses worker processes, as a model
+ * of a run on as many machines. The coordinator sorts the points by X in a
+ * shared mapping, made read-only, and forks the workers. Worker k solves
+ * the k-th slab of consecutive points with nearestPoints_DC_Merge, with
+ * its own minimum distance d, and writes to its part of a shared mailbox
+ * the result and its boundary strips: the points closer than d to the
+ * first and to the last X of its slab. A pair across slabs closer than
+ * every worker's d has both points in such strips, so the coordinator
+ * solves the strips together and keeps the best answer.
+ * A worker that dies, or can't be forked, has its slab solved by the
+ * coordinator. Measures are returned in "stats" if not NULL.
+ * vp is sorted by X on return.
+ */
+Result nearestPoints_MultiProcess(vector<Point> &vp, int numProcesses, MultiProcessStats *stats = NULL);
+
+#endif /* MULTIPROCESSNEARESTPOINTS_H_ */
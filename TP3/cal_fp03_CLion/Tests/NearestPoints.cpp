@@ -6,57 +6,302 @@
 #include <thread>
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <random>
+#include <cstdint>
 #include "NearestPoints.h"
 #include "Point.h"
+#include "PointSoA.h"
+#include "TaskPool.h"
+#include "RadixSort.h"
+#include "NearestPointsCommon.h"
 
 const double MAX_DOUBLE = std::numeric_limits<double>::max();
 
-Result::Result(double dmin, Point p1, Point p2) {
+template <class Scalar>
+ResultT<Scalar>::ResultT(double dmin, PointT<Scalar> p1, PointT<Scalar> p2) {
 	this->dmin = dmin;
 	this->p1 = p1;
 	this->p2 = p2;
 }
 
-Result::Result() {
+template <class Scalar>
+ResultT<Scalar>::ResultT() {
 	this->dmin = MAX_DOUBLE;
-	this->p1 = Point(0,0);
-	this->p2 = Point(0,0);
+	this->p1 = PointT<Scalar>(0,0);
+	this->p2 = PointT<Scalar>(0,0);
 }
 
+// Shorter ranges are sorted with std::sort
+static const int RADIX_SORT_CUTOFF = 4096;
+
 /**
- * Auxiliary functions to sort vector of points by X or Y axis.
+ * Sorts v[left..right] by X (ties by Y), with a radix sort if the range
+ * is long, in parallel if "tasks" is not NULL.
  */
-static void sortByX(vector<Point> &v, int left, int right)
+template <class Scalar>
+static void sortByX(vector<PointT<Scalar> > &v, int left, int right, TaskPool *tasks = NULL)
 {
-	std::sort(v.begin( ) + left, v.begin() + right + 1,
-		[](Point p, Point q){ return p.x < q.x || (p.x == q.x && p.y < q.y); });
+	if (right - left + 1 >= RADIX_SORT_CUTOFF)
+		radixSort<KeyByX<Scalar> >(v.data() + left, right - left + 1, tasks);
+	else if (right > left)
+		std::sort(v.begin( ) + left, v.begin() + right + 1, lessByX<Scalar>);
 }
 
-static void sortByY(vector<Point> &v, int left, int right)
+template <class Scalar>
+static void sortByY(vector<PointT<Scalar> > &v, int left, int right, TaskPool *tasks = NULL)
 {
-	std::sort(v.begin( ) + left, v.begin() + right + 1,
-		[](Point p, Point q){ return p.y < q.y || (p.y == q.y && p.x < q.x); });
+	if (right - left + 1 >= RADIX_SORT_CUTOFF)
+		radixSort<KeyByY<Scalar> >(v.data() + left, right - left + 1, tasks);
+	else if (right > left)
+		std::sort(v.begin( ) + left, v.begin() + right + 1, lessByY<Scalar>);
 }
 
 /**
- * Brute force algorithm O(N^2).
+ * Compares all the pairs of the n points stored in x[] and y[], for pairs
+ * at squared distance below d2. Updates d2 and the indices i, j of the
+ * best pair.
  */
-Result nearestPoints_BF(vector<Point> &vp) {
-	Result res;
-	// TODO
-	return res;
+static void allPairsScalar(const double *x, const double *y, int n, double &d2, int &bi, int &bj)
+{
+	for (int i = 0; i < n; i++)
+		for (int j = i + 1; j < n; j++)
+		{
+			double dx = x[j] - x[i], dy = y[j] - y[i];
+			double d = dx * dx + dy * dy;
+			if (d < d2)
+			{
+				d2 = d;
+				bi = i;
+				bj = j;
+			}
+		}
 }
 
 /**
- * Improved brute force algorithm, that first sorts points by X axis.
+ * Scans a strip of n points sorted by y, stored in x[] and y[], for pairs at
+ * squared distance below d2. Updates d2 and the indices i, j of the best pair.
  */
-Result nearestPoints_BF_SortByX(vector<Point> &vp) {
-	Result res;
-	sortByX(vp, 0, vp.size()-1);
-	// TODO
-	return res;
+static void stripScanScalar(const double *x, const double *y, int n, double &d2, int &bi, int &bj)
+{
+	for (int i = 0; i < n; i++)
+		for (int j = i + 1; j < n; j++)
+		{
+			double dy = y[j] - y[i];
+			if (dy * dy >= d2)
+				break;
+			double dx = x[j] - x[i];
+			double d = dx * dx + dy * dy;
+			if (d < d2)
+			{
+				d2 = d;
+				bi = i;
+				bj = j;
+			}
+		}
 }
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define NP_STRIP_AVX2
+
+/**
+ * Same as stripScanScalar, comparing each point with its next 4 neighbours
+ * at once. Relies on the +infinity padding of PointSoA after the last point.
+ */
+__attribute__((target("avx2")))
+static void stripScanAVX2(const double *x, const double *y, int n, double &d2, int &bi, int &bj)
+{
+	alignas(32) double d[4];
+	for (int i = 0; i < n; i++)
+	{
+		__m256d xi = _mm256_set1_pd(x[i]);
+		__m256d yi = _mm256_set1_pd(y[i]);
+		for (int j = i + 1; j < n; j += 4)
+		{
+			// Lanes further than this in y are also further in distance
+			double dy0 = y[j] - y[i];
+			if (dy0 * dy0 >= d2)
+				break;
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), xi);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), yi);
+			__m256d dist = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+			int mask = _mm256_movemask_pd(_mm256_cmp_pd(dist, _mm256_set1_pd(d2), _CMP_LT_OQ));
+			if (mask == 0)
+				continue;
+			_mm256_store_pd(d, dist);
+			for (int k = 0; k < 4; k++)
+				if ((mask >> k & 1) && d[k] < d2)
+				{
+					d2 = d[k];
+					bi = i;
+					bj = j + k;
+				}
+		}
+	}
+}
+
+/**
+ * Same as allPairsScalar, comparing each point with 4 others at once.
+ * Every lane keeps its own minimum and the indices of its pair, without
+ * branches; the lanes are reduced at the end. Relies on the +infinity
+ * padding of PointSoA after the last point.
+ */
+__attribute__((target("avx2")))
+static void allPairsAVX2(const double *x, const double *y, int n, double &d2, int &bi, int &bj)
+{
+	__m256d best = _mm256_set1_pd(d2);
+	__m256d bestI = _mm256_set1_pd(-1), bestJ = _mm256_set1_pd(-1);
+	const __m256d lanes = _mm256_set_pd(3, 2, 1, 0);
+	for (int i = 0; i < n; i++)
+	{
+		__m256d xi = _mm256_set1_pd(x[i]);
+		__m256d yi = _mm256_set1_pd(y[i]);
+		__m256d iv = _mm256_set1_pd(i);
+		for (int j = i + 1; j < n; j += 4)
+		{
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), xi);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), yi);
+			__m256d dist = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+			__m256d closer = _mm256_cmp_pd(dist, best, _CMP_LT_OQ);
+			best = _mm256_blendv_pd(best, dist, closer);
+			bestI = _mm256_blendv_pd(bestI, iv, closer);
+			bestJ = _mm256_blendv_pd(bestJ, _mm256_add_pd(_mm256_set1_pd(j), lanes), closer);
+		}
+	}
+	alignas(32) double d[4], li[4], lj[4];
+	_mm256_store_pd(d, best);
+	_mm256_store_pd(li, bestI);
+	_mm256_store_pd(lj, bestJ);
+	for (int k = 0; k < 4; k++)
+		if (d[k] < d2)
+		{
+			d2 = d[k];
+			bi = (int) li[k];
+			bj = (int) lj[k];
+		}
+}
+
+/**
+ * Same, 8 points at once. The lanes past the last point are masked off,
+ * since the padding only covers 4 of them.
+ */
+__attribute__((target("avx512f")))
+static void allPairsAVX512(const double *x, const double *y, int n, double &d2, int &bi, int &bj)
+{
+	__m512d best = _mm512_set1_pd(d2);
+	__m512d bestI = _mm512_set1_pd(-1), bestJ = _mm512_set1_pd(-1);
+	const __m512d lanes = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+	for (int i = 0; i < n; i++)
+	{
+		__m512d xi = _mm512_set1_pd(x[i]);
+		__m512d yi = _mm512_set1_pd(y[i]);
+		__m512d iv = _mm512_set1_pd(i);
+		for (int j = i + 1; j < n; j += 8)
+		{
+			__mmask8 valid = n - j >= 8 ? 0xFF : (__mmask8) ((1 << (n - j)) - 1);
+			__m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(valid, x + j), xi);
+			__m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(valid, y + j), yi);
+			__m512d dist = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+			__mmask8 closer = _mm512_mask_cmp_pd_mask(valid, dist, best, _CMP_LT_OQ);
+			best = _mm512_mask_blend_pd(closer, best, dist);
+			bestI = _mm512_mask_blend_pd(closer, bestI, iv);
+			bestJ = _mm512_mask_blend_pd(closer, bestJ, _mm512_add_pd(_mm512_set1_pd(j), lanes));
+		}
+	}
+	alignas(64) double d[8], li[8], lj[8];
+	_mm512_store_pd(d, best);
+	_mm512_store_pd(li, bestI);
+	_mm512_store_pd(lj, bestJ);
+	for (int k = 0; k < 8; k++)
+		if (d[k] < d2)
+		{
+			d2 = d[k];
+			bi = (int) li[k];
+			bj = (int) lj[k];
+		}
+}
+
+static bool cpuHasAVX2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static bool cpuHasAVX512()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f");
+}
+
+static const bool hasAVX2 = cpuHasAVX2();
+static const bool hasAVX512 = cpuHasAVX512();
+#endif
+
+/**
+ * allPairsScalar and stripScanScalar, with the fastest kernel the
+ * processor supports.
+ */
+static void allPairs(const double *x, const double *y, int n, double &d2, int &bi, int &bj)
+{
+#ifdef NP_STRIP_AVX2
+	if (hasAVX512)
+		allPairsAVX512(x, y, n, d2, bi, bj);
+	else if (hasAVX2)
+		allPairsAVX2(x, y, n, d2, bi, bj);
+	else
+#endif
+		allPairsScalar(x, y, n, d2, bi, bj);
+}
+
+static void stripScan(const double *x, const double *y, int n, double &d2, int &bi, int &bj)
+{
+#ifdef NP_STRIP_AVX2
+	if (hasAVX2)
+		stripScanAVX2(x, y, n, d2, bi, bj);
+	else
+#endif
+		stripScanScalar(x, y, n, d2, bi, bj);
+}
+
+// Ranges of np_DC this short are solved by brute force, instead of
+// splitting them further and sorting their strips (best measured on 1M
+// random points with each kernel)
+#ifdef NP_STRIP_AVX2
+static const int bfCutoff = hasAVX512 ? 256 : 128;
+#else
+static const int bfCutoff = 128;
+#endif
+
+/**
+ * Compares all the pairs of points of vp between indices left and right
+ * (inclusive), updating "res".
+ */
+template <class Scalar>
+static void npBF(vector<PointT<Scalar> > &vp, int left, int right, Closest<Scalar> &res)
+{
+	for (int i = left; i < right; i++)
+		for (int j = i + 1; j <= right; j++)
+			res.update(vp[i], vp[j]);
+}
+
+/**
+ * Same, for double coordinates: the points are copied to a per thread
+ * PointSoA and compared with AVX-512 or AVX2, whichever the processor
+ * supports.
+ */
+template <>
+void npBF<double>(vector<Point> &vp, int left, int right, Closest<double> &res)
+{
+	static thread_local PointSoA points;
+	points.assign(vp, left, right);
+	double d2 = res.d2;
+	int i = -1, j = -1;
+	allPairs(points.x(), points.y(), points.size(), d2, i, j);
+	// The kernel only picks the pair: its d2 may be rounded differently
+	if (i >= 0)
+		res.update(vp[left + i], vp[left + j]);
+}
 
 /**
  * Auxiliary function to find nearest points in strip, as indicated
@@ -64,69 +309,519 @@ Result nearestPoints_BF_SortByX(vector<Point> &vp) {
  * The strip is the part of vp between indices left and right (inclusive).
  * "res" contains initially the best solution found so far.
  */
-static void npByY(vector<Point> &vp, int left, int right, Result &res)
+template <class Scalar>
+static void npByY(vector<PointT<Scalar> > &vp, int left, int right, Closest<Scalar> &res)
+{
+	typedef typename PointT<Scalar>::dist_type Dist;
+	for (int i = left; i < right; i++)
+		for (int j = i + 1; j <= right && within((Dist) vp[j].y - vp[i].y, res.d2); j++)
+			res.update(vp[i], vp[j]);
+}
+
+/**
+ * Same, for double coordinates: the strip is copied to a per thread
+ * PointSoA and scanned with AVX2 when the processor supports it.
+ */
+template <>
+void npByY<double>(vector<Point> &vp, int left, int right, Closest<double> &res)
+{
+	static thread_local PointSoA strip;
+	strip.assign(vp, left, right);
+	double d2 = res.d2;
+	int i = -1, j = -1;
+	stripScan(strip.x(), strip.y(), strip.size(), d2, i, j);
+	// Exact distance, as in npBF
+	if (i >= 0)
+		res.update(vp[left + i], vp[left + j]);
+}
+
+/**
+ * Brute force algorithm O(N^2).
+ */
+template <class Scalar>
+ResultT<Scalar> nearestPoints_BF(vector<PointT<Scalar> > &vp) {
+	Closest<Scalar> res;
+	npBF(vp, 0, vp.size() - 1, res);
+	return res.result();
+}
+
+/**
+ * Improved brute force algorithm, that first sorts points by X axis: the
+ * points after vp[i] are only compared with it while they are closer in x
+ * than the best pair so far.
+ */
+template <class Scalar>
+ResultT<Scalar> nearestPoints_BF_SortByX(vector<PointT<Scalar> > &vp) {
+	typedef typename PointT<Scalar>::dist_type Dist;
+	Closest<Scalar> res;
+	sortByX(vp, 0, vp.size()-1);
+	for (int i = 0; i < (int) vp.size(); i++)
+		for (int j = i + 1; j < (int) vp.size() && within((Dist) vp[j].x - vp[i].x, res.d2); j++)
+			res.update(vp[i], vp[j]);
+	return res.result();
+}
+
+/**
+ * Pool configuration and the pool itself, created on first use.
+ */
+static PoolConfig poolConfig;
+static unique_ptr<TaskPool> pool;
+
+PoolConfig::PoolConfig(int numThreads, int sequentialCutoff) :
+		numThreads(numThreads), sequentialCutoff(sequentialCutoff) {}
+
+void setPoolConfig(const PoolConfig &config)
+{
+	if (config.numThreads != poolConfig.numThreads)
+		pool.reset();
+	poolConfig = config;
+}
+
+PoolConfig getPoolConfig()
+{
+	return poolConfig;
+}
+
+TaskPool *getPool()
 {
-	// TODO
+	if (pool == NULL)
+		pool.reset(new TaskPool(poolConfig.numThreads));
+	return pool.get();
+}
+
+/**
+ * Defines the number of threads to be used.
+ */
+void setNumThreads(int num)
+{
+	setPoolConfig(PoolConfig(num, poolConfig.sequentialCutoff));
 }
 
 /**
  * Recursive divide and conquer algorithm.
- * Finds the nearest points in "vp" between indices left and right (inclusive),
- * using at most numThreads.
+ * Finds the nearest points in "vp" between indices left and right (inclusive).
+ * If "tasks" is not NULL, the halves are solved as tasks of that pool, down
+ * to the sequential cutoff of the pool configuration.
  */
-static Result np_DC(vector<Point> &vp, int left, int right, int numThreads) {
-	// Base case of two points
-	// TODO
+template <class Scalar>
+static Closest<Scalar> np_DC(vector<PointT<Scalar> > &vp, int left, int right, TaskPool *tasks) {
+	typedef typename PointT<Scalar>::dist_type Dist;
+	Closest<Scalar> res;
 
-	// Base case of a single point: no solution, so distance is MAX_DOUBLE
-	// TODO
+	// Base case of a few points, by brute force (a single point has no
+	// solution, so distance is the maximum)
+	if (right - left + 1 <= bfCutoff)
+	{
+		npBF(vp, left, right, res);
+		return res;
+	}
 
 	// Divide in halves (left and right) and solve them recursively,
-	// possibly in parallel (in case numThreads > 1)
-	// TODO
+	// possibly in parallel (in case a pool is given)
+	int middle = (left + right) / 2;
+	Closest<Scalar> resLeft, resRight;
+	if (tasks != NULL && right - left + 1 > poolConfig.sequentialCutoff)
+		tasks->invoke([&]{ resLeft = np_DC(vp, left, middle, tasks); },
+				[&]{ resRight = np_DC(vp, middle + 1, right, tasks); });
+	else
+	{
+		resLeft = np_DC(vp, left, middle, (TaskPool *) NULL);
+		resRight = np_DC(vp, middle + 1, right, (TaskPool *) NULL);
+	}
 
 	// Select the best solution from left and right
-	// TODO
+	res = resLeft.best(resRight);
 
-	// Determine the strip area around middle point
-	// TODO
+	// Determine the strip area around middle point (the left half has
+	// x <= midX and the right half x >= midX)
+	Scalar midX = vp[middle].x;
+	int stripLeft = middle, stripRight = middle + 1;
+	while (stripLeft > left && within((Dist) midX - vp[stripLeft - 1].x, res.d2))
+		stripLeft--;
+	while (stripRight < right && within((Dist) vp[stripRight + 1].x - midX, res.d2))
+		stripRight++;
 
 	// Order points in strip area by Y coordinate
-	// TODO
+	sortByY(vp, stripLeft, stripRight);
 
 	// Calculate nearest points in strip area (using npByY function)
-	// TODO
+	npByY(vp, stripLeft, stripRight, res);
 
 	// Reorder points in strip area back by X coordinate
-	//TODO
+	sortByX(vp, stripLeft, stripRight);
+
+	return res;
+}
+
+/*
+ * Divide and conquer approach, single-threaded version.
+ */
+template <class Scalar>
+ResultT<Scalar> nearestPoints_DC(vector<PointT<Scalar> > &vp) {
+	sortByX(vp, 0, vp.size() -1);
+	return np_DC(vp, 0, vp.size() - 1, (TaskPool *) NULL).result();
+}
+
 
-	//return res;
+/*
+ * Multi-threaded version, using the pool of threads configured
+ * by setPoolConfig() or setNumThreads().
+ */
+template <class Scalar>
+ResultT<Scalar> nearestPoints_DC_MT(vector<PointT<Scalar> > &vp) {
+	sortByX(vp, 0, vp.size() -1, getPool());
+	return np_DC(vp, 0, vp.size() - 1, getPool()).result();
 }
 
 
 /**
- * Defines the number of threads to be used.
+ * Divide and conquer with presorted Y, in O(n log n).
+ * Same as np_DC, but on return vp[left..right] is sorted by Y: the halves
+ * come back sorted by Y and are merged, as in merge sort, through "scratch"
+ * (as large as vp), so the strip needs no sorting. The strip is then
+ * gathered in Y order into scratch[left..].
  */
-static int numThreads = 1;
-void setNumThreads(int num)
-{
-	numThreads = num;
+template <class Scalar>
+static Closest<Scalar> np_DC_Merge(vector<PointT<Scalar> > &vp, vector<PointT<Scalar> > &scratch,
+		int left, int right, TaskPool *tasks) {
+	typedef typename PointT<Scalar>::dist_type Dist;
+
+	// Base cases of up to three points, by brute force
+	if (right - left < 3)
+	{
+		Closest<Scalar> res;
+		for (int i = left; i < right; i++)
+			for (int j = i + 1; j <= right; j++)
+				res.update(vp[i], vp[j]);
+		sortByY(vp, left, right);
+		return res;
+	}
+
+	// The dividing line must be taken before the halves are reordered by Y
+	int middle = (left + right) / 2;
+	Scalar midX = vp[middle].x;
+
+	Closest<Scalar> resLeft, resRight;
+	if (tasks != NULL && right - left + 1 > poolConfig.sequentialCutoff)
+		tasks->invoke([&]{ resLeft = np_DC_Merge(vp, scratch, left, middle, tasks); },
+				[&]{ resRight = np_DC_Merge(vp, scratch, middle + 1, right, tasks); });
+	else
+	{
+		resLeft = np_DC_Merge(vp, scratch, left, middle, (TaskPool *) NULL);
+		resRight = np_DC_Merge(vp, scratch, middle + 1, right, (TaskPool *) NULL);
+	}
+	Closest<Scalar> res = resLeft.best(resRight);
+
+	// Merge the halves by Y
+	merge(vp.begin() + left, vp.begin() + middle + 1, vp.begin() + middle + 1, vp.begin() + right + 1,
+			scratch.begin() + left, lessByY<Scalar>);
+	copy(scratch.begin() + left, scratch.begin() + right + 1, vp.begin() + left);
+
+	// Strip area around the dividing line, already in Y order
+	int stripRight = left - 1;
+	for (int i = left; i <= right; i++)
+		if (within((Dist) vp[i].x - midX, res.d2))
+			scratch[++stripRight] = vp[i];
+	npByY(scratch, left, stripRight, res);
+
+	return res;
 }
 
 /*
- * Divide and conquer approach, single-threaded version.
+ * Divide and conquer with presorted Y (see np_DC_Merge), single-threaded.
  */
-Result nearestPoints_DC(vector<Point> &vp) {
+template <class Scalar>
+ResultT<Scalar> nearestPoints_DC_Merge(vector<PointT<Scalar> > &vp) {
 	sortByX(vp, 0, vp.size() -1);
-	return np_DC(vp, 0, vp.size() - 1, 1);
+	vector<PointT<Scalar> > scratch(vp.size());
+	return np_DC_Merge(vp, scratch, 0, vp.size() - 1, (TaskPool *) NULL).result();
+}
+
+/*
+ * Divide and conquer with presorted Y, using the pool of threads.
+ */
+template <class Scalar>
+ResultT<Scalar> nearestPoints_DC_Merge_MT(vector<PointT<Scalar> > &vp) {
+	sortByX(vp, 0, vp.size() -1, getPool());
+	vector<PointT<Scalar> > scratch(vp.size());
+	return np_DC_Merge(vp, scratch, 0, vp.size() - 1, getPool()).result();
 }
 
 
 /*
- * Multi-threaded version, using the number of threads specified
- * by setNumThreads().
+ * Divide and conquer with presorted Y, for points stored as a PointSoA:
+ * the sort by X reads its arrays and writes the points straight to the
+ * working array, with scratch as its buffer, so there is no other copy.
  */
-Result nearestPoints_DC_MT(vector<Point> &vp) {
-	sortByX(vp, 0, vp.size() -1);
-	return np_DC(vp, 0, vp.size() - 1, numThreads);
+static Result npSoA(const PointSoA &points, TaskPool *tasks)
+{
+	int n = points.size();
+	const double *xs = points.x(), *ys = points.y();
+	vector<Point> vp(n), scratch(n);
+	radixSortFrom<KeyByX<double> >([xs, ys](size_t i) { return Point(xs[i], ys[i]); },
+			n, vp.data(), scratch.data(), tasks);
+	return np_DC_Merge(vp, scratch, 0, n - 1, tasks).result();
+}
+
+Result nearestPoints_DC_Merge(const PointSoA &points)
+{
+	return npSoA(points, (TaskPool *) NULL);
+}
+
+Result nearestPoints_DC_Merge_MT(const PointSoA &points)
+{
+	return npSoA(points, getPool());
+}
+
+
+// Sets of a batch this small are solved by brute force, larger ones by
+// sorting them by X and scanning them as a strip (measured crossovers)
+#ifdef NP_STRIP_AVX2
+static const int batchBFMax = hasAVX512 ? 384 : 128;
+#else
+static const int batchBFMax = 128;
+#endif
+
+/**
+ * Closest pair of the n points of p, for nearestPoints_Batch, in the per
+ * thread buffers "sorted" and "soa" (nothing is allocated once they are
+ * as large as the largest set).
+ */
+static Result npSmallSet(const Point *p, int n, vector<Point> &sorted, PointSoA &soa)
+{
+	if (n < 2)
+		return Result();
+	double d2 = numeric_limits<double>::infinity();
+	int i = -1, j = -1;
+	if (n <= batchBFMax)
+	{
+		soa.assign(p, n);
+		allPairs(soa.x(), soa.y(), n, d2, i, j);
+		return i < 0 ? Result() : Result(p[i].distance(p[j]), p[i], p[j]);
+	}
+	sorted.assign(p, p + n);
+	std::sort(sorted.begin(), sorted.end(), lessByX<double>);
+	soa.assign(sorted, 0, n - 1);
+	// A strip scan stops at the first point too far in "y": give it the x
+	stripScan(soa.y(), soa.x(), n, d2, i, j);
+	return i < 0 ? Result() : Result(sorted[i].distance(sorted[j]), sorted[i], sorted[j]);
+}
+
+/**
+ * Solves the sets of a batch, as tasks of "tasks" if not NULL, in chunks
+ * of consecutive sets.
+ */
+static void npBatch(const Point *points, const size_t *offsets, int numSets, Result *results, TaskPool *tasks)
+{
+	if (numSets <= 0)
+		return;
+	int chunks = tasks == NULL ? 1 : min(numSets, 8 * tasks->getNumThreads());
+	forEachTask(tasks, 0, chunks, [&](int c) {
+		static thread_local vector<Point> sorted;
+		static thread_local PointSoA soa;
+		int end = (long) numSets * (c + 1) / chunks;
+		for (int s = (long) numSets * c / chunks; s < end; s++)
+			results[s] = npSmallSet(points + offsets[s], offsets[s + 1] - offsets[s], sorted, soa);
+	});
+}
+
+void nearestPoints_Batch(const Point *points, const size_t *offsets, int numSets, Result *results)
+{
+	npBatch(points, offsets, numSets, results, (TaskPool *) NULL);
+}
+
+void nearestPoints_Batch_MT(const Point *points, const size_t *offsets, int numSets, Result *results)
+{
+	npBatch(points, offsets, numSets, results, getPool());
+}
+
+/*
+ * Marks the empty slots of a GridTable: NaN for floating point
+ * coordinates, the lowest value for integers (outside the range where
+ * their distances are exact).
+ */
+template <class Scalar>
+struct EmptySlot {
+	static Scalar mark() { return numeric_limits<Scalar>::quiet_NaN(); }
+	static bool is(Scalar x) { return x != x; }
+};
+
+template <>
+struct EmptySlot<int32_t> {
+	static int32_t mark() { return numeric_limits<int32_t>::min(); }
+	static bool is(int32_t x) { return x == numeric_limits<int32_t>::min(); }
+};
+
+/**
+ * Open addressing hash table from the cells of a square grid to the points
+ * in them, for nearestPoints_Grid. A cell with several points has one entry
+ * per point, found by linear probing from the slot of the cell. Entries
+ * hold the points themselves, so a lookup touches no other memory.
+ */
+template <class Scalar>
+class GridTable {
+	typedef PointT<Scalar> P;
+	vector<P> entries;
+	size_t count;
+	double side, originX, originY;
+
+	bool empty(size_t k) const
+	{
+		return EmptySlot<Scalar>::is(entries[k].x);
+	}
+
+	int64_t cell(Scalar v, double origin) const
+	{
+		return (int64_t) floor(((double) v - origin) / side);
+	}
+
+	// Cells (cx, cy) and (cx, cy + 1) hash to consecutive slots
+	size_t slot(int64_t cx, int64_t cy) const
+	{
+		uint64_t h = (uint64_t) cx * 0x9E3779B97F4A7C15ULL;
+		return (size_t) ((h ^ (h >> 29)) + (uint64_t) cy) & (entries.size() - 1);
+	}
+
+	void place(const P &p)
+	{
+		size_t k = slot(cell(p.x, originX), cell(p.y, originY));
+		while (!empty(k))
+			k = (k + 1) & (entries.size() - 1);
+		entries[k] = p;
+	}
+
+	void grow()
+	{
+		vector<P> old(entries.size() * 2, P(EmptySlot<Scalar>::mark(), 0));
+		old.swap(entries);
+		for (size_t k = 0; k < old.size(); k++)
+			if (!EmptySlot<Scalar>::is(old[k].x))
+				place(old[k]);
+	}
+public:
+	GridTable() : count(0), side(1), originX(0), originY(0) {}
+
+	/**
+	 * Empties the table, for cells of the given side, with room for about
+	 * "expected" points before growing.
+	 */
+	void reset(double side, double originX, double originY, size_t expected)
+	{
+		size_t size = 16;
+		while (size < 2 * expected)
+			size *= 2;
+		entries.assign(size, P(EmptySlot<Scalar>::mark(), 0));
+		count = 0;
+		this->side = side;
+		this->originX = originX;
+		this->originY = originY;
+	}
+
+	void insert(const P &p)
+	{
+		if (2 * (count + 1) > entries.size())
+			grow();
+		place(p);
+		count++;
+	}
+
+	/**
+	 * Looks in the 3 x 3 cells around q for a point closer than the best
+	 * pair in "res", and updates it. Returns true if one is found.
+	 */
+	bool nearest(const P &q, Closest<Scalar> &res) const
+	{
+		int64_t cx = cell(q.x, originX), cy = cell(q.y, originY);
+		size_t mask = entries.size() - 1;
+		bool found = false;
+		for (int64_t a = cx - 1; a <= cx + 1; a++)
+		{
+			// The entries of the cells (a, cy - 1 .. cy + 1) are all in the
+			// probe runs that start in the 3 consecutive slots from s; other
+			// points met on the way are harmless extra candidates
+			size_t s = slot(a, cy - 1);
+			for (size_t k = 0; k < 3 || !empty((s + k) & mask); k++)
+			{
+				const P &e = entries[(s + k) & mask];
+				if (EmptySlot<Scalar>::is(e.x) || e.distSquare(q) >= res.d2)
+					continue;
+				res.d2 = e.distSquare(q);
+				res.p1 = e;
+				res.p2 = q;
+				found = true;
+			}
+		}
+		return found;
+	}
+};
+
+/*
+ * Randomized closest pair by grid hashing (Rabin; Khuller and Matias),
+ * expected O(n). The points are shuffled and added one at a time, keeping
+ * the closest distance d among the points added so far in a grid of d x d
+ * cells: a new point can only be closer than d to points in its own or the
+ * 8 neighbouring cells. When it is, d shrinks and the grid is rebuilt
+ * for the new d, which happens O(log n) times on average.
+ */
+template <class Scalar>
+ResultT<Scalar> nearestPoints_Grid(vector<PointT<Scalar> > &vp) {
+	int n = vp.size();
+	if (n < 2)
+		return ResultT<Scalar>();
+
+	mt19937 gen(n);
+	std::shuffle(vp.begin(), vp.end(), gen);
+	double minX = vp[0].x, maxX = minX, minY = vp[0].y, maxY = minY;
+	for (int i = 1; i < n; i++)
+	{
+		minX = min(minX, (double) vp[i].x);
+		maxX = max(maxX, (double) vp[i].x);
+		minY = min(minY, (double) vp[i].y);
+		maxY = max(maxY, (double) vp[i].y);
+	}
+	double extent = max(maxX - minX, maxY - minY);
+
+	Closest<Scalar> res;
+	res.update(vp[0], vp[1]);
+	GridTable<Scalar> grid;
+	for (int i = 1; i < n && res.d2 > 0; i++)
+	{
+		if (i > 1)
+		{
+			if (!grid.nearest(vp[i], res))
+			{
+				grid.insert(vp[i]);
+				continue;
+			}
+			if (res.d2 == 0)
+				break;
+		}
+
+		// New closest distance: rebuild the grid with points 0..i. The cells
+		// are made slightly larger than d, so that rounding in the cell
+		// numbers can't separate two points closer than d by two cells.
+		double side = sqrt((double) res.d2) * (1 + 1e-9);
+		if (extent / side > 1e15)
+			return nearestPoints_DC_Merge(vp); // cell numbers would not fit in 64 bits
+		grid.reset(side, minX, minY, i + 1);
+		for (int k = 0; k <= i; k++)
+			grid.insert(vp[k]);
+	}
+	return res.result();
 }
+
+
+// Supported coordinate types
+#define INSTANTIATE_NEAREST_POINTS(Scalar) \
+	template class ResultT<Scalar>; \
+	template ResultT<Scalar> nearestPoints_BF(vector<PointT<Scalar> > &vp); \
+	template ResultT<Scalar> nearestPoints_BF_SortByX(vector<PointT<Scalar> > &vp); \
+	template ResultT<Scalar> nearestPoints_DC(vector<PointT<Scalar> > &vp); \
+	template ResultT<Scalar> nearestPoints_DC_MT(vector<PointT<Scalar> > &vp); \
+	template ResultT<Scalar> nearestPoints_DC_Merge(vector<PointT<Scalar> > &vp); \
+	template ResultT<Scalar> nearestPoints_DC_Merge_MT(vector<PointT<Scalar> > &vp); \
+	template ResultT<Scalar> nearestPoints_Grid(vector<PointT<Scalar> > &vp);
+
+INSTANTIATE_NEAREST_POINTS(int32_t)
+INSTANTIATE_NEAREST_POINTS(float)
+INSTANTIATE_NEAREST_POINTS(double)
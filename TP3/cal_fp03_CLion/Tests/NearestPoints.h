@@ -1,4 +1,3 @@
-
 #ifndef UTIL_H_
 #define UTIL_H_
 
@@ -7,20 +6,66 @@
 /*
  * Auxiliary class to store a solution.
  */
-class Result {
+template <class Scalar>
+class ResultT {
 public:
 	double dmin; // distance between selected points
-	Point p1, p2; // selected points
-	Result(double dmin2, Point p1, Point p2);
-	Result();
+	PointT<Scalar> p1, p2; // selected points
+	ResultT(double dmin2, PointT<Scalar> p1, PointT<Scalar> p2);
+	ResultT();
 };
+typedef ResultT<double> Result;
+
+/*
+ * Functions using different algorithms, for points with int32_t, float or
+ * double coordinates (instantiated in NearestPoints.cpp). Pairs are compared
+ * by exact squared distances (see PointT::distSquare).
+ */
+template <class Scalar> ResultT<Scalar> nearestPoints_BF(vector<PointT<Scalar> > &vp);
+template <class Scalar> ResultT<Scalar> nearestPoints_BF_SortByX(vector<PointT<Scalar> > &vp);
+template <class Scalar> ResultT<Scalar> nearestPoints_DC(vector<PointT<Scalar> > &vp);
+template <class Scalar> ResultT<Scalar> nearestPoints_DC_MT(vector<PointT<Scalar> > &vp);
+template <class Scalar> ResultT<Scalar> nearestPoints_DC_Merge(vector<PointT<Scalar> > &vp);    // merges halves by Y instead of sorting the strip
+template <class Scalar> ResultT<Scalar> nearestPoints_DC_Merge_MT(vector<PointT<Scalar> > &vp);
+template <class Scalar> ResultT<Scalar> nearestPoints_Grid(vector<PointT<Scalar> > &vp);        // randomized grid hashing, expected O(n)
+
+/*
+ * Same as nearestPoints_DC_Merge(_MT), for points stored as a PointSoA,
+ * such as a mapped point file (see loadPointFile), which are not changed:
+ * the sort by X reads them straight from its arrays, so they need not be
+ * copied to a vector<Point> first.
+ */
+class PointSoA;
+Result nearestPoints_DC_Merge(const PointSoA &points);
+Result nearestPoints_DC_Merge_MT(const PointSoA &points);
 
-// Functions using different algorithms
-Result nearestPoints_BF(vector<Point> &vp);
-Result nearestPoints_BF_SortByX(vector<Point> &vp);
-Result nearestPoints_DC(vector<Point> &vp);
-Result nearestPoints_DC_MT(vector<Point> &vp);
-void setNumThreads(int num);
+/*
+ * Configuration of the pool of threads used by the _MT variants.
+ * The pool is kept between calls and only rebuilt when numThreads changes.
+ */
+struct PoolConfig {
+	int numThreads;       // threads sharing the work, the caller included
+	int sequentialCutoff; // sub-problems with fewer points are solved sequentially
+	PoolConfig(int numThreads = 1, int sequentialCutoff = 8192);
+};
+void setPoolConfig(const PoolConfig &config);
+PoolConfig getPoolConfig();
+void setNumThreads(int num); // changes only numThreads in the pool config
+class TaskPool;
+TaskPool *getPool();          // the pool itself, created on first use
+
+/*
+ * Closest pairs of a batch of independent sets of points, such as many
+ * sets of a few hundred points. Set s is points[offsets[s]] to
+ * points[offsets[s + 1] - 1] (offsets has numSets + 1 entries), and its
+ * answer goes to results[s] (results must have room for numSets).
+ * Small sets are solved by brute force and larger ones sorted by X, in
+ * per thread buffers that are reused from set to set, so that nothing is
+ * allocated per set. The _MT version solves chunks of consecutive sets in
+ * parallel, in the pool of threads.
+ */
+void nearestPoints_Batch(const Point *points, const size_t *offsets, int numSets, Result *results);
+void nearestPoints_Batch_MT(const Point *points, const size_t *offsets, int numSets, Result *results);
 
 // Pointer to function that computes nearest points
 typedef Result (*NP_FUNC)(vector<Point> &vp);
@@ -0,0 +1,89 @@
+/*
+ * NearestPointsCommon.h
+ */
+
+#ifndef NEARESTPOINTSCOMMON_H_
+#define NEARESTPOINTSCOMMON_H_
+
+#include <limits>
+#include <cmath>
+#include "Point.h"
+#include "NearestPoints.h"
+
+using namespace std;
+
+/*
+ * Best pair found so far, by exact squared distance (see PointT::distSquare).
+ * All the algorithms compare squared distances, so that with integer
+ * coordinates no rounding can pick the wrong pair.
+ */
+template <class Scalar>
+struct Closest {
+	typedef PointT<Scalar> P;
+	typedef typename P::dist_type Dist;
+	Dist d2;
+	P p1, p2;
+
+	Closest() : d2(numeric_limits<Dist>::max()), p1(0, 0), p2(0, 0) {}
+
+	void update(const P &a, const P &b)
+	{
+		Dist d = a.distSquare(b);
+		if (d < d2)
+		{
+			d2 = d;
+			p1 = a;
+			p2 = b;
+		}
+	}
+
+	const Closest &best(const Closest &other) const
+	{
+		return d2 <= other.d2 ? *this : other;
+	}
+
+	ResultT<Scalar> result() const
+	{
+		if (d2 == numeric_limits<Dist>::max())
+			return ResultT<Scalar>();
+		return ResultT<Scalar>(sqrt((double) d2), p1, p2);
+	}
+};
+
+/*
+ * Is coordinate distance dx within the squared distance d2? (dx * dx < d2)
+ */
+template <class Dist>
+inline bool within(Dist dx, Dist d2)
+{
+	return dx * dx < d2;
+}
+
+/**
+ * Auxiliary functions to sort vector of points by X or Y axis.
+ */
+template <class Scalar>
+inline bool lessByX(const PointT<Scalar> &p, const PointT<Scalar> &q)
+{
+	return p.x < q.x || (p.x == q.x && p.y < q.y);
+}
+
+template <class Scalar>
+inline bool lessByY(const PointT<Scalar> &p, const PointT<Scalar> &q)
+{
+	return p.y < q.y || (p.y == q.y && p.x < q.x);
+}
+
+template <class Scalar>
+struct KeyByX {
+	static Scalar primary(const PointT<Scalar> &p) { return p.x; }
+	static Scalar secondary(const PointT<Scalar> &p) { return p.y; }
+};
+
+template <class Scalar>
+struct KeyByY {
+	static Scalar primary(const PointT<Scalar> &p) { return p.y; }
+	static Scalar secondary(const PointT<Scalar> &p) { return p.x; }
+};
+
+#endif /* NEARESTPOINTSCOMMON_H_ */
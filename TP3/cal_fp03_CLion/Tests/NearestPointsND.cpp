@@ -0,0 +1,309 @@
+/*
+ * NearestPointsND.cpp
+ */
+
+#include "NearestPointsND.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include "TaskPool.h"
+#include "RadixSort.h"
+
+template <int D, class Scalar>
+ResultND<D, Scalar>::ResultND(double dmin, const PointND<D, Scalar> &p1, const PointND<D, Scalar> &p2) :
+		dmin(dmin), p1(p1), p2(p2)
+{
+}
+
+template <int D, class Scalar>
+ResultND<D, Scalar>::ResultND() : dmin(numeric_limits<double>::max())
+{
+	for (int i = 0; i < D; i++)
+		p1[i] = p2[i] = 0;
+}
+
+/*
+ * Best pair found so far, by exact squared distance.
+ */
+template <int D, class Scalar>
+struct ClosestND {
+	typedef PointND<D, Scalar> P;
+	typedef typename P::dist_type Dist;
+	Dist d2;
+	const P *p1, *p2;
+
+	ClosestND() : d2(numeric_limits<Dist>::max()), p1(NULL), p2(NULL) {}
+
+	void update(const P &a, const P &b)
+	{
+		Dist d = a.distSquare(b);
+		if (d < d2)
+		{
+			d2 = d;
+			p1 = &a;
+			p2 = &b;
+		}
+	}
+};
+
+/*
+ * Best pair, with copies of its points (the points move while merging).
+ */
+template <int D, class Scalar>
+struct PairND {
+	typedef PointND<D, Scalar> P;
+	typedef typename P::dist_type Dist;
+	Dist d2;
+	P p1, p2;
+
+	PairND() : d2(numeric_limits<Dist>::max()) {}
+
+	const PairND &best(const PairND &other) const
+	{
+		return d2 <= other.d2 ? *this : other;
+	}
+
+	void take(const ClosestND<D, Scalar> &c)
+	{
+		if (c.p1 != NULL && c.d2 < d2)
+		{
+			d2 = c.d2;
+			p1 = *c.p1;
+			p2 = *c.p2;
+		}
+	}
+
+	ResultND<D, Scalar> result() const
+	{
+		if (d2 == numeric_limits<Dist>::max())
+			return ResultND<D, Scalar>();
+		return ResultND<D, Scalar>(sqrt((double) d2), p1, p2);
+	}
+};
+
+/*
+ * Orders points by coordinate A, then by all coordinates in order.
+ */
+template <int A>
+struct LessByAxis {
+	template <class P>
+	bool operator()(const P &p, const P &q) const
+	{
+		if (p[A] != q[A])
+			return p[A] < q[A];
+		return lexicographical_compare(p.c, p.c + P::dimension, q.c, q.c + P::dimension);
+	}
+};
+
+/*
+ * Radix sort key of the first sort: only the first coordinate matters, so
+ * ties are just broken by the second one.
+ */
+template <int D, class Scalar>
+struct KeyByAxis0 {
+	static Scalar primary(const PointND<D, Scalar> &p) { return p[0]; }
+	static Scalar secondary(const PointND<D, Scalar> &p) { return p[1]; }
+};
+
+/**
+ * Scans a strip sorted by the second coordinate: each point is compared
+ * with the following ones until they are farther than the best distance
+ * in that coordinate alone. Gives up, returning false, after "budget"
+ * comparisons (the pairs compared so far are still taken into account).
+ */
+template <int D, class Scalar>
+static bool stripScan(const vector<PointND<D, Scalar> > &strip, int left, int right,
+		ClosestND<D, Scalar> &res, long budget)
+{
+	typedef typename PointND<D, Scalar>::dist_type Dist;
+	for (int i = left; i < right; i++)
+		for (int j = i + 1; j <= right; j++)
+		{
+			Dist dy = (Dist) strip[j][1] - strip[i][1];
+			if (dy * dy >= res.d2)
+				break;
+			if (--budget < 0)
+				return false;
+			res.update(strip[i], strip[j]);
+		}
+	return true;
+}
+
+// Comparisons per point of a strip of 3 or more dimensions scanned in
+// order of the second coordinate, before bucketing it in cells instead
+static const long STRIP_SCAN_BUDGET = 32;
+
+/*
+ * Point of a strip (by its index) with its cell in a grid over the
+ * coordinates other than the first.
+ */
+template <int D>
+struct StripCell {
+	int64_t cell[D - 1];
+	int index;
+};
+
+template <int D>
+static bool lessByCell(const StripCell<D> &p, const StripCell<D> &q)
+{
+	return lexicographical_compare(p.cell, p.cell + D - 1, q.cell, q.cell + D - 1);
+}
+
+/**
+ * Solves a strip of 3 or more dimensions, for which ordering it by the
+ * second coordinate bounds nothing in the others (points on a line
+ * parallel to the third axis would all be compared with each other). The
+ * strip is bucketed in cells of side d, the best distance, over all the
+ * coordinates but the first, and each point is compared with the points
+ * of the 3^(D-1) cells around it. Only a constant number of points at
+ * least d apart fit in a cell of the strip, so this takes O(m log m) for
+ * m points: sorting the cells, and one binary search per run of 3
+ * neighbouring cells (consecutive in the order of the cells).
+ */
+template <int D, class Scalar>
+static void stripGrid(const vector<PointND<D, Scalar> > &strip, int left, int right,
+		ClosestND<D, Scalar> &res)
+{
+	int m = right - left + 1;
+	if (m < 2 || res.d2 == 0)
+		return;
+	// Slightly larger cells, so that rounding can't put two points closer
+	// than d two cells apart
+	double side = sqrt((double) res.d2) * (1 + 1e-9);
+	static thread_local vector<StripCell<D> > cells;
+	cells.resize(m);
+	for (int i = 0; i < m; i++)
+	{
+		for (int a = 1; a < D; a++)
+		{
+			double c = floor((double) strip[left + i][a] / side);
+			if (!(fabs(c) < 1e18))
+			{
+				// Cell numbers would not fit in 64 bits
+				stripScan(strip, left, right, res, numeric_limits<long>::max());
+				return;
+			}
+			cells[i].cell[a - 1] = (int64_t) c;
+		}
+		cells[i].index = left + i;
+	}
+	sort(cells.begin(), cells.begin() + m, lessByCell<D>);
+
+	// Each pair is compared once, from the point that comes first by cell
+	int runs = 1;
+	for (int a = 2; a < D; a++)
+		runs *= 3;
+	StripCell<D> key;
+	for (int i = 0; i < m; i++)
+		for (int k = 0; k < runs; k++)
+		{
+			// Cells around cell i in all but the last coordinate, from -1 in the last
+			for (int a = 0, r = k; a < D - 2; a++, r /= 3)
+				key.cell[a] = cells[i].cell[a] + r % 3 - 1;
+			key.cell[D - 2] = cells[i].cell[D - 2] - 1;
+			int64_t last = cells[i].cell[D - 2] + 1;
+			auto it = lower_bound(cells.begin() + i + 1, cells.begin() + m, key, lessByCell<D>);
+			for (; it != cells.begin() + m && equal(key.cell, key.cell + D - 2, it->cell)
+					&& it->cell[D - 2] <= last; ++it)
+				res.update(strip[cells[i].index], strip[it->index]);
+		}
+}
+
+/**
+ * Closest pair of vp[left..right], sorted by the first coordinate; on
+ * return they are sorted by the second one. See np_DC_Merge.
+ */
+template <int D, class Scalar>
+static PairND<D, Scalar> np_DC_ND(vector<PointND<D, Scalar> > &vp, vector<PointND<D, Scalar> > &scratch,
+		int left, int right, TaskPool *tasks, int cutoff)
+{
+	typedef typename PointND<D, Scalar>::dist_type Dist;
+	PairND<D, Scalar> res;
+
+	// Base cases of up to three points, by brute force
+	if (right - left < 3)
+	{
+		ClosestND<D, Scalar> c;
+		for (int i = left; i < right; i++)
+			for (int j = i + 1; j <= right; j++)
+				c.update(vp[i], vp[j]);
+		res.take(c);
+		sort(vp.begin() + left, vp.begin() + right + 1, LessByAxis<1>());
+		return res;
+	}
+
+	int middle = (left + right) / 2;
+	Scalar mid = vp[middle][0];
+
+	PairND<D, Scalar> resLeft, resRight;
+	if (tasks != NULL && right - left + 1 > cutoff)
+		tasks->invoke([&]{ resLeft = np_DC_ND(vp, scratch, left, middle, tasks, cutoff); },
+				[&]{ resRight = np_DC_ND(vp, scratch, middle + 1, right, tasks, cutoff); });
+	else
+	{
+		resLeft = np_DC_ND(vp, scratch, left, middle, (TaskPool *) NULL, cutoff);
+		resRight = np_DC_ND(vp, scratch, middle + 1, right, (TaskPool *) NULL, cutoff);
+	}
+	res = resLeft.best(resRight);
+
+	// Merge the halves by the second coordinate
+	merge(vp.begin() + left, vp.begin() + middle + 1, vp.begin() + middle + 1, vp.begin() + right + 1,
+			scratch.begin() + left, LessByAxis<1>());
+	copy(scratch.begin() + left, scratch.begin() + right + 1, vp.begin() + left);
+
+	// Strip around the dividing plane, already in order
+	int stripRight = left - 1;
+	for (int i = left; i <= right; i++)
+	{
+		Dist dx = (Dist) vp[i][0] - mid;
+		if (dx * dx < res.d2)
+			scratch[++stripRight] = vp[i];
+	}
+	ClosestND<D, Scalar> c;
+	c.d2 = res.d2;
+	if (D == 2)
+		stripScan(scratch, left, stripRight, c, numeric_limits<long>::max());
+	else if (!stripScan(scratch, left, stripRight, c, STRIP_SCAN_BUDGET * (stripRight - left + 1L)))
+		stripGrid(scratch, left, stripRight, c);
+	res.take(c);
+	return res;
+}
+
+template <int D, class Scalar>
+ResultND<D, Scalar> nearestPointsND_DC(vector<PointND<D, Scalar> > &vp)
+{
+	if (vp.size() < 2)
+		return ResultND<D, Scalar>();
+	radixSort<KeyByAxis0<D, Scalar> >(vp.data(), vp.size(), (TaskPool *) NULL);
+	vector<PointND<D, Scalar> > scratch(vp.size());
+	return np_DC_ND(vp, scratch, 0, vp.size() - 1, (TaskPool *) NULL, 0).result();
+}
+
+template <int D, class Scalar>
+ResultND<D, Scalar> nearestPointsND_DC_MT(vector<PointND<D, Scalar> > &vp)
+{
+	if (vp.size() < 2)
+		return ResultND<D, Scalar>();
+	radixSort<KeyByAxis0<D, Scalar> >(vp.data(), vp.size(), getPool());
+	vector<PointND<D, Scalar> > scratch(vp.size());
+	return np_DC_ND(vp, scratch, 0, vp.size() - 1, getPool(), getPoolConfig().sequentialCutoff).result();
+}
+
+
+// Supported dimensions and coordinate types
+#define INSTANTIATE_NEAREST_POINTS_ND(D, Scalar) \
+	template class ResultND<D, Scalar>; \
+	template ResultND<D, Scalar> nearestPointsND_DC(vector<PointND<D, Scalar> > &vp); \
+	template ResultND<D, Scalar> nearestPointsND_DC_MT(vector<PointND<D, Scalar> > &vp);
+
+INSTANTIATE_NEAREST_POINTS_ND(2, int32_t)
+INSTANTIATE_NEAREST_POINTS_ND(2, float)
+INSTANTIATE_NEAREST_POINTS_ND(2, double)
+INSTANTIATE_NEAREST_POINTS_ND(3, int32_t)
+INSTANTIATE_NEAREST_POINTS_ND(3, float)
+INSTANTIATE_NEAREST_POINTS_ND(3, double)
+INSTANTIATE_NEAREST_POINTS_ND(4, int32_t)
+INSTANTIATE_NEAREST_POINTS_ND(4, float)
+INSTANTIATE_NEAREST_POINTS_ND(4, double)
@@ -0,0 +1,41 @@
+/*
+ * NearestPointsND.h
+ */
+
+#ifndef NEARESTPOINTSND_H_
+#define NEARESTPOINTSND_H_
+
+#include <vector>
+#include "PointND.h"
+#include "NearestPoints.h"
+
+using namespace std;
+
+/*
+ * Solution for points of D dimensions.
+ */
+template <int D, class Scalar>
+class ResultND {
+public:
+	double dmin; // distance between selected points
+	PointND<D, Scalar> p1, p2; // selected points
+	ResultND(double dmin, const PointND<D, Scalar> &p1, const PointND<D, Scalar> &p2);
+	ResultND();
+};
+
+/*
+ * Divide and conquer for points of D dimensions: the points are split by
+ * the first coordinate and merged back by the second, as in
+ * nearestPoints_DC_Merge, and the strip around each dividing plane is
+ * scanned in order of the second coordinate, comparing full (unrolled)
+ * distances. For D >= 3 that scan alone could compare every pair (points
+ * spread only along the other coordinates), so a strip that takes too
+ * many comparisons is bucketed in a grid of cells of side the best
+ * distance instead, which keeps the whole in O(n log^2 n).
+ * Instantiated in NearestPointsND.cpp for D = 2, 3, 4 and int32_t, float
+ * or double coordinates.
+ */
+template <int D, class Scalar> ResultND<D, Scalar> nearestPointsND_DC(vector<PointND<D, Scalar> > &vp);
+template <int D, class Scalar> ResultND<D, Scalar> nearestPointsND_DC_MT(vector<PointND<D, Scalar> > &vp); // with the pool of threads
+
+#endif /* NEARESTPOINTSND_H_ */
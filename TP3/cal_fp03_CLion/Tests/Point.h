@@ -7,23 +7,62 @@
 
 #include <iostream>
 #include <vector>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
 
 using namespace std;
 
-class Point {
+/*
+ * Type of the squared distance between points with coordinates of type
+ * Scalar: exact 64-bit integers for integer coordinates, double otherwise
+ * (also for float, to keep the precision of the coordinates).
+ */
+template <class Scalar>
+struct SquaredDistance {
+	typedef double type;
+};
+
+template <>
+struct SquaredDistance<int32_t> {
+	typedef int64_t type;
+};
+
+/*
+ * Point with coordinates of type Scalar (int32_t, float or double).
+ * With int32_t coordinates, distSquare is exact as long as the coordinates
+ * are less than 2^30 in absolute value.
+ * There are no virtual members, so a point is just its two coordinates and
+ * can be copied with memcpy.
+ */
+template <class Scalar>
+class PointT {
 public:
-	double x;
-	double y;
-
-	Point();
-	Point(double x, double y);
-	Point(int x, int y);
-	double distance(Point &p);
-	double distSquare(Point &p); // distance squared
-	virtual ~Point();
-	bool operator==(const Point &p) const;
+	typedef Scalar scalar_type;
+	typedef typename SquaredDistance<Scalar>::type dist_type;
+
+	Scalar x;
+	Scalar y;
+
+	PointT() = default;
+	PointT(Scalar x, Scalar y) : x(x), y(y) {}
+	double distance(const PointT &p) const { return sqrt((double) distSquare(p)); }
+	dist_type distSquare(const PointT &p) const // distance squared
+	{
+		dist_type dx = (dist_type) x - p.x, dy = (dist_type) y - p.y;
+		return dx * dx + dy * dy;
+	}
+	bool operator==(const PointT &p) const { return x == p.x && y == p.y; }
 };
-ostream& operator<<(ostream& os, Point &p);
 
+template <class Scalar>
+ostream& operator<<(ostream& os, const PointT<Scalar> &p);
+
+typedef PointT<double> Point;
+typedef PointT<float> PointF;
+typedef PointT<int32_t> PointI;
+
+static_assert(is_trivially_copyable<Point>::value, "Point must be trivially copyable");
+static_assert(sizeof(PointF) == 8 && sizeof(PointI) == 8, "float and int points take 8 bytes");
 
 #endif /* POINT_H_ */
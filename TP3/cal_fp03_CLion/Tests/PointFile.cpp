@@ -0,0 +1,265 @@
+/*
+ * PointFile.cpp
+ */
+
+#include "PointFile.h"
+
+#include <fstream>
+#include <cstring>
+#include <limits>
+#include <charconv>
+#include <thread>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint64_t alignUp(uint64_t bytes)
+{
+	return (bytes + POINT_FILE_ALIGNMENT - 1) / POINT_FILE_ALIGNMENT * POINT_FILE_ALIGNMENT;
+}
+
+/**
+ * Writes one array of coordinates, with its padding, up to the next aligned offset.
+ */
+static void writeArray(ofstream &os, const vector<double> &values)
+{
+	vector<double> padded(values);
+	padded.resize(values.size() + PointSoA::PADDING, numeric_limits<double>::infinity());
+	uint64_t bytes = padded.size() * sizeof(double);
+	os.write(reinterpret_cast<const char *>(padded.data()), bytes);
+	vector<char> zeros(alignUp(bytes) - bytes, 0);
+	os.write(zeros.data(), zeros.size());
+}
+
+bool writePointFile(const string &file, const vector<Point> &vp)
+{
+	ofstream os(file.c_str(), ios::binary);
+	if (!os)
+		return false;
+
+	PointFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, POINT_FILE_MAGIC, sizeof(header.magic));
+	header.byteOrder = POINT_FILE_BYTE_ORDER;
+	header.padding = PointSoA::PADDING;
+	header.count = vp.size();
+	header.xOffset = alignUp(sizeof(header));
+	header.yOffset = header.xOffset + alignUp((vp.size() + PointSoA::PADDING) * sizeof(double));
+	os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	vector<char> zeros(header.xOffset - sizeof(header), 0);
+	os.write(zeros.data(), zeros.size());
+
+	vector<double> coords(vp.size());
+	for (size_t i = 0; i < vp.size(); i++)
+		coords[i] = vp[i].x;
+	writeArray(os, coords);
+	for (size_t i = 0; i < vp.size(); i++)
+		coords[i] = vp[i].y;
+	writeArray(os, coords);
+	return (bool) os;
+}
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+/**
+ * Number of white space separated tokens in [begin, end).
+ */
+static size_t countTokens(const char *begin, const char *end)
+{
+	size_t count = 0;
+	bool inToken = false;
+	for (const char *p = begin; p < end; p++)
+	{
+		bool space = isSpace(*p);
+		count += !space && !inToken;
+		inToken = !space;
+	}
+	return count;
+}
+
+/**
+ * Parses the numbers in [begin, end), the first being number "first" of
+ * the file, into the coordinates of vp (number k is vp[k / 2].x or .y).
+ * A last unpaired number is ignored.
+ */
+static bool parseTokens(const char *begin, const char *end, size_t first, vector<Point> &vp)
+{
+	size_t k = first;
+	const char *p = begin;
+	while (true)
+	{
+		while (p < end && isSpace(*p))
+			p++;
+		if (p == end)
+			return true;
+		if (*p == '+') // accepted by >>, not by from_chars
+			p++;
+		double value;
+		from_chars_result r = from_chars(p, end, value);
+		if (r.ec != errc() || (r.ptr < end && !isSpace(*r.ptr)))
+			return false;
+		if (k / 2 < vp.size())
+		{
+			if (k % 2 == 0)
+				vp[k / 2].x = value;
+			else
+				vp[k / 2].y = value;
+		}
+		k++;
+		p = r.ptr;
+	}
+}
+
+bool readPointText(const string &file, vector<Point> &vp, int numThreads)
+{
+	vp.clear();
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	size_t length = st.st_size;
+	if (length == 0)
+	{
+		close(fd);
+		return true;
+	}
+	void *base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return false;
+	madvise(base, length, MADV_SEQUENTIAL);
+	const char *text = static_cast<const char *>(base);
+
+	// Chunks of about the same size, ending at line breaks
+	if (numThreads <= 0)
+		numThreads = max(1u, thread::hardware_concurrency());
+	vector<const char *> bounds(1, text);
+	for (int t = 1; t < numThreads; t++)
+	{
+		const char *p = max(bounds.back(), text + length / numThreads * t);
+		while (p < text + length && *p != '\n')
+			p++;
+		if (p < text + length)
+			bounds.push_back(p + 1);
+	}
+	bounds.push_back(text + length);
+	int chunks = bounds.size() - 1;
+
+	vector<size_t> first(chunks + 1, 0);
+	vector<char> ok(chunks, true);
+	vector<thread> threads;
+	for (int c = 1; c < chunks; c++)
+		threads.push_back(thread([&, c]{ first[c + 1] = countTokens(bounds[c], bounds[c + 1]); }));
+	first[1] = countTokens(bounds[0], bounds[1]);
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+	for (int c = 1; c <= chunks; c++)
+		first[c] += first[c - 1];
+
+	vp.resize(first[chunks] / 2);
+	threads.clear();
+	for (int c = 1; c < chunks; c++)
+		threads.push_back(thread([&, c]{ ok[c] = parseTokens(bounds[c], bounds[c + 1], first[c], vp); }));
+	ok[0] = parseTokens(bounds[0], bounds[1], 0, vp);
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+	munmap(base, length);
+
+	if (find(ok.begin(), ok.end(), false) != ok.end())
+	{
+		vp.clear();
+		return false;
+	}
+	return true;
+}
+
+bool convertPointFile(const string &textFile, const string &binaryFile)
+{
+	vector<Point> vp;
+	if (!readPointText(textFile, vp))
+		return false;
+	return writePointFile(binaryFile, vp);
+}
+
+/**
+ * Is "header" that of a valid point file of "length" bytes for this machine?
+ * The arrays must start after the header, and are checked against the
+ * length without adding to the offsets, which could wrap around.
+ */
+static bool validHeader(const PointFileHeader &header, uint64_t length)
+{
+	uint64_t arrayBytes = (header.count + PointSoA::PADDING) * sizeof(double);
+	return memcmp(header.magic, POINT_FILE_MAGIC, sizeof(header.magic)) == 0
+			&& header.byteOrder == POINT_FILE_BYTE_ORDER
+			&& header.padding >= (uint32_t) PointSoA::PADDING
+			&& header.count < ((uint64_t) 1 << 59)
+			&& header.xOffset % POINT_FILE_ALIGNMENT == 0 && header.yOffset % POINT_FILE_ALIGNMENT == 0
+			&& header.xOffset >= sizeof(PointFileHeader) && header.yOffset >= sizeof(PointFileHeader)
+			&& header.xOffset <= length && arrayBytes <= length - header.xOffset
+			&& header.yOffset <= length && arrayBytes <= length - header.yOffset;
+}
+
+/**
+ * Are the PointSoA::PADDING slots after the "count" values of "a" all
+ * +infinity, as PointSoA::adopt requires?
+ */
+static bool paddedWithInfinity(const double *a, uint64_t count)
+{
+	for (int k = 0; k < PointSoA::PADDING; k++)
+		if (a[count + k] != numeric_limits<double>::infinity())
+			return false;
+	return true;
+}
+
+bool readPointFileHeader(const string &file, PointFileHeader &header)
+{
+	ifstream is(file.c_str(), ios::binary | ios::ate);
+	if (!is)
+		return false;
+	uint64_t length = is.tellg();
+	is.seekg(0);
+	if (length < sizeof(header) || !is.read(reinterpret_cast<char *>(&header), sizeof(header)))
+		return false;
+	return validHeader(header, length);
+}
+
+bool loadPointFile(const string &file, PointSoA &points)
+{
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(PointFileHeader))
+	{
+		close(fd);
+		return false;
+	}
+	size_t length = st.st_size;
+	void *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return false;
+	shared_ptr<void> mapping(base, [length](void *p) { munmap(p, length); });
+
+	const PointFileHeader *header = static_cast<const PointFileHeader *>(base);
+	if (!validHeader(*header, length) || header->count > (uint64_t) numeric_limits<int>::max())
+		return false;
+
+	char *bytes = static_cast<char *>(base);
+	double *xs = reinterpret_cast<double *>(bytes + header->xOffset);
+	double *ys = reinterpret_cast<double *>(bytes + header->yOffset);
+	if (!paddedWithInfinity(xs, header->count) || !paddedWithInfinity(ys, header->count))
+		return false;
+	points.adopt(xs, ys, (int) header->count, mapping);
+	return true;
+}
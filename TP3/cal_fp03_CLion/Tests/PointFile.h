@@ -0,0 +1,75 @@
+/*
+ * PointFile.h
+ */
+
+#ifndef POINTFILE_H_
+#define POINTFILE_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Point.h"
+#include "PointSoA.h"
+
+using namespace std;
+
+/*
+ * Binary point file: a header, then all x coordinates, then all y
+ * coordinates, as native doubles. Each array starts at a multiple of
+ * POINT_FILE_ALIGNMENT bytes and is followed by PointSoA::PADDING slots
+ * of +infinity, so a mapped file is a valid PointSoA as it is.
+ */
+const char POINT_FILE_MAGIC[8] = {'C', 'A', 'L', 'P', 'T', 'S', '0', '1'};
+const int POINT_FILE_ALIGNMENT = 64;
+const uint32_t POINT_FILE_BYTE_ORDER = 0x01020304; // as written by this machine
+
+struct PointFileHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t padding;  // +infinity slots after each array
+	uint64_t count;    // number of points
+	uint64_t xOffset;  // offset of the x array, in bytes from the start of the file
+	uint64_t yOffset;  // offset of the y array
+	char reserved[24];
+};
+
+/**
+ * Writes the points of vp to a binary point file. Returns false on failure.
+ */
+bool writePointFile(const string &file, const vector<Point> &vp);
+
+/**
+ * Reads a text file of "x y" pairs (as the Pontos files), i.e. numbers
+ * separated by any white space, into vp. The file is mapped into memory
+ * and split in chunks at line breaks, one per thread (numThreads <= 0 means
+ * one per hardware thread). Each thread counts the numbers of its chunk,
+ * then parses them with from_chars straight into its part of vp, sized
+ * from the counts. Returns false (with vp empty) if the file can't be read
+ * or has something other than numbers.
+ */
+bool readPointText(const string &file, vector<Point> &vp, int numThreads = 0);
+
+/**
+ * Converts a text file of "x y" pairs (as the Pontos files) to a binary
+ * point file. Returns false if the text file can't be read or the binary
+ * one can't be written.
+ */
+bool convertPointFile(const string &textFile, const string &binaryFile);
+
+/**
+ * Reads the header of a binary point file, without reading the points.
+ * Returns false if the file is missing or not a valid point file for this
+ * machine.
+ */
+bool readPointFileHeader(const string &file, PointFileHeader &header);
+
+/**
+ * Maps a binary point file into memory and makes "points" use it directly:
+ * nothing is parsed or copied, pages are read on first access. Changes to
+ * the points are private to the process. Returns false (leaving "points"
+ * unchanged) if the file is missing or not a valid point file for this
+ * machine, including arrays not followed by +infinity.
+ */
+bool loadPointFile(const string &file, PointSoA &points);
+
+#endif /* POINTFILE_H_ */
@@ -0,0 +1,68 @@
+/*
+ * PointGenerator.cpp
+ */
+
+#include "PointGenerator.h"
+
+static void shuffle(vector<Point> &vp, int left, int right, mt19937 &gen)
+{
+	uniform_int_distribution<int> dis(0, right - left + 1);
+	for (int i = left; i < right; i++)
+	{
+		int k = i + dis(gen) % (right - i + 1);
+		Point tmp = vp[i];
+		vp[i] = vp[k];
+		vp[k] = tmp;
+	}
+}
+
+static void shuffleY(vector<Point> &vp, int left, int right, mt19937 &gen)
+{
+	uniform_int_distribution<int> dis(0, right - left + 1);
+	for (int i = left; i < right; i++)
+	{
+		int k = i + dis(gen) % (right - i + 1);
+		double tmp = vp[i].y;
+		vp[i].y = vp[k].y;
+		vp[k].y = tmp;
+	}
+}
+
+void generateRandom(int n, vector<Point> &vp, unsigned seed)
+{
+	mt19937 gen(seed);
+	uniform_int_distribution<int> dis(0, n - 1);
+
+	vp.clear();
+	// reference value for reference points (r, r), (r, r+1)
+	int r = dis(gen);
+	vp.push_back(Point(r, r));
+	vp.push_back(Point(r, r + 1));
+	for (int i = 2; i < n; i++)
+		if (i < r)
+			vp.push_back(Point(i, i));
+		else
+			vp.push_back(Point(i + 1, i + 2));
+	shuffleY(vp, 2, n - 1, gen);
+	shuffle(vp, 0, n - 1, gen);
+}
+
+void generateRandomConstX(int n, vector<Point> &vp, unsigned seed)
+{
+	mt19937 gen(seed);
+	uniform_int_distribution<int> dis(0, n - 1);
+
+	vp.clear();
+	// reference value for min dist
+	int r = dis(gen);
+	int y = 0;
+	for (int i = 0; i < n; i++)
+	{
+		vp.push_back(Point(0, y));
+		if (i == r)
+			y++;
+		else
+			y += 1 + dis(gen) % 100;
+	}
+	shuffleY(vp, 0, n - 1, gen);
+}
@@ -0,0 +1,29 @@
+/*
+ * PointGenerator.h
+ */
+
+#ifndef POINTGENERATOR_H_
+#define POINTGENERATOR_H_
+
+#include <vector>
+#include <random>
+#include "Point.h"
+
+using namespace std;
+
+/*
+ * Generators of the random point sets used by the tests and the benchmark.
+ * The same seed always gives the same set; by default a random seed is used.
+ */
+
+/**
+ * Generates a vector of n distinct points with minimum distance 1.
+ */
+void generateRandom(int n, vector<Point> &vp, unsigned seed = random_device()());
+
+/**
+ * Similar, but with constant X.
+ */
+void generateRandomConstX(int n, vector<Point> &vp, unsigned seed = random_device()());
+
+#endif /* POINTGENERATOR_H_ */
@@ -0,0 +1,77 @@
+/*
+ * PointND.h
+ */
+
+#ifndef POINTND_H_
+#define POINTND_H_
+
+#include <iostream>
+#include <cmath>
+#include <utility>
+#include "Point.h"
+
+using namespace std;
+
+/*
+ * Point with D coordinates of type Scalar (int32_t, float or double).
+ * Operations over the coordinates are expanded at compile time (no loop
+ * over D). With int32_t coordinates, distSquare is exact as long as the
+ * coordinates are less than 2^29 in absolute value, for D up to 8.
+ */
+template <int D, class Scalar>
+class PointND {
+	static_assert(D >= 2, "points have at least two dimensions");
+
+	template <size_t... I>
+	typename SquaredDistance<Scalar>::type distSquare(const PointND &p, index_sequence<I...>) const
+	{
+		return (square((dist_type) c[I] - p.c[I]) + ...);
+	}
+
+	static typename SquaredDistance<Scalar>::type square(typename SquaredDistance<Scalar>::type d)
+	{
+		return d * d;
+	}
+public:
+	typedef Scalar scalar_type;
+	typedef typename SquaredDistance<Scalar>::type dist_type;
+	static const int dimension = D;
+
+	Scalar c[D]; // coordinates
+
+	PointND() = default;
+	template <class... S>
+	PointND(S... coords) : c{(Scalar) coords...}
+	{
+		static_assert(sizeof...(S) == D, "one value per coordinate");
+	}
+	Scalar &operator[](int i) { return c[i]; }
+	const Scalar &operator[](int i) const { return c[i]; }
+	double distance(const PointND &p) const { return sqrt((double) distSquare(p)); }
+	dist_type distSquare(const PointND &p) const { return distSquare(p, make_index_sequence<D>()); }
+	bool operator==(const PointND &p) const
+	{
+		for (int i = 0; i < D; i++)
+			if (c[i] != p.c[i])
+				return false;
+		return true;
+	}
+};
+
+template <int D, class Scalar>
+ostream& operator<<(ostream& os, const PointND<D, Scalar> &p)
+{
+	os << "(" << p[0];
+	for (int i = 1; i < D; i++)
+		os << "," << p[i];
+	os << ")";
+	return os;
+}
+
+typedef PointND<3, double> Point3;
+typedef PointND<4, double> Point4;
+
+static_assert(is_trivially_copyable<Point3>::value, "PointND must be trivially copyable");
+static_assert(sizeof(Point3) == 3 * sizeof(double), "a PointND is just its coordinates");
+
+#endif /* POINTND_H_ */
@@ -0,0 +1,216 @@
+/*
+ * PointSetIndex.cpp
+ */
+
+#include "PointSetIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include "RadixSort.h"
+#include "TaskPool.h"
+#include "NearestPointsCommon.h"
+
+/*
+ * A point and its index, to sort the indices with the points.
+ */
+struct IndexedPoint {
+	Point p;
+	int index;
+};
+
+struct IndexByX {
+	static double primary(const IndexedPoint &e) { return e.p.x; }
+	static double secondary(const IndexedPoint &e) { return e.p.y; }
+};
+
+struct IndexByY {
+	static double primary(const IndexedPoint &e) { return e.p.y; }
+	static double secondary(const IndexedPoint &e) { return e.p.x; }
+};
+
+PointSetIndex::PointSetIndex() : sorted(false)
+{
+}
+
+PointSetIndex::PointSetIndex(const vector<Point> &vp) : points(vp), sorted(false)
+{
+}
+
+const vector<Point> &PointSetIndex::getPoints() const
+{
+	return points;
+}
+
+int PointSetIndex::size() const
+{
+	return points.size();
+}
+
+void PointSetIndex::set(int i, const Point &p)
+{
+	points[i] = p;
+	sorted = false;
+}
+
+int PointSetIndex::add(const Point &p)
+{
+	points.push_back(p);
+	sorted = false;
+	return points.size() - 1;
+}
+
+/**
+ * Computes the cached orders, if the points changed since last time.
+ */
+void PointSetIndex::sort()
+{
+	if (sorted)
+		return;
+	int n = points.size();
+	vector<IndexedPoint> items(n);
+	for (int i = 0; i < n; i++)
+	{
+		items[i].p = points[i];
+		items[i].index = i;
+	}
+	radixSort<IndexByX>(items.data(), n, (TaskPool *) NULL);
+	byX.resize(n);
+	rankX.resize(n);
+	sortedX.resize(n);
+	for (int k = 0; k < n; k++)
+	{
+		byX[k] = items[k].index;
+		rankX[items[k].index] = k;
+		sortedX[k] = items[k].p;
+	}
+	radixSort<IndexByY>(items.data(), n, (TaskPool *) NULL);
+	byY.resize(n);
+	ranksByY.resize(n);
+	for (int k = 0; k < n; k++)
+	{
+		byY[k] = items[k].index;
+		ranksByY[k] = rankX[items[k].index];
+	}
+	sorted = true;
+}
+
+const vector<int> &PointSetIndex::orderByX()
+{
+	sort();
+	return byX;
+}
+
+const vector<int> &PointSetIndex::orderByY()
+{
+	sort();
+	return byY;
+}
+
+/**
+ * Closest pair of px[lo..hi[ (in X order), given their positions in Y
+ * order in ys[0..hi - lo[. The halves get their Y orders, split from ys,
+ * in arena[0..hi - lo[, and use the rest of the arena for their own
+ * halves (2 * (hi - lo) + 64 positions in all). Halves larger than
+ * "cutoff" run as tasks of "tasks", if not NULL.
+ */
+static Closest<double> solveRange(const vector<Point> &px, int lo, int hi, const int *ys, int *arena,
+		TaskPool *tasks, int cutoff)
+{
+	int n = hi - lo;
+	Closest<double> res;
+	if (n <= 3)
+	{
+		for (int i = lo; i < hi; i++)
+			for (int j = i + 1; j < hi; j++)
+				res.update(px[i], px[j]);
+		return res;
+	}
+
+	int mid = lo + n / 2;
+	double midX = px[mid].x;
+	int *left = arena, *right = arena + (mid - lo);
+	for (int k = 0, a = 0, b = 0; k < n; k++)
+		if (ys[k] < mid)
+			left[a++] = ys[k];
+		else
+			right[b++] = ys[k];
+
+	Closest<double> resLeft, resRight;
+	if (tasks != NULL && n > cutoff)
+	{
+		vector<int> rightArena(2 * (hi - mid) + 64);
+		tasks->invoke([&]{ resLeft = solveRange(px, lo, mid, left, arena + n, tasks, cutoff); },
+				[&]{ resRight = solveRange(px, mid, hi, right, rightArena.data(), tasks, cutoff); });
+	}
+	else
+	{
+		resLeft = solveRange(px, lo, mid, left, arena + n, NULL, cutoff);
+		resRight = solveRange(px, mid, hi, right, arena + n, NULL, cutoff);
+	}
+	res = resLeft.best(resRight);
+
+	// Strip around the dividing line, in Y order, in the arena (the halves are done with it)
+	int m = 0;
+	for (int k = 0; k < n; k++)
+	{
+		double dx = px[ys[k]].x - midX;
+		if (dx * dx < res.d2)
+			arena[m++] = ys[k];
+	}
+	for (int i = 0; i < m; i++)
+		for (int j = i + 1; j < m; j++)
+		{
+			double dy = px[arena[j]].y - px[arena[i]].y;
+			if (dy * dy >= res.d2)
+				break;
+			res.update(px[arena[i]], px[arena[j]]);
+		}
+	return res;
+}
+
+Result PointSetIndex::solve(int lo, int hi, const int *ys, TaskPool *tasks)
+{
+	if (hi - lo < 2)
+		return Result();
+	vector<int> arena(2 * (hi - lo) + 64);
+	return solveRange(sortedX, lo, hi, ys, arena.data(), tasks, getPoolConfig().sequentialCutoff).result();
+}
+
+Result PointSetIndex::closest()
+{
+	sort();
+	return solve(0, size(), ranksByY.data(), NULL);
+}
+
+Result PointSetIndex::closest_MT()
+{
+	sort();
+	return solve(0, size(), ranksByY.data(), getPool());
+}
+
+Result PointSetIndex::closestInRange(double minX, double maxX)
+{
+	sort();
+	int lo = lower_bound(sortedX.begin(), sortedX.end(), minX,
+			[](const Point &p, double x) { return p.x < x; }) - sortedX.begin();
+	int hi = upper_bound(sortedX.begin(), sortedX.end(), maxX,
+			[](double x, const Point &p) { return x < p.x; }) - sortedX.begin();
+	if (hi - lo < 2)
+		return Result();
+
+	// Y order of the range: sorting it is cheaper than a pass over all the points if it is small
+	int m = hi - lo;
+	vector<int> ys;
+	ys.reserve(m);
+	if (m * log2((double) m) < size())
+	{
+		for (int r = lo; r < hi; r++)
+			ys.push_back(r);
+		std::sort(ys.begin(), ys.end(), [this](int a, int b) { return lessByY(sortedX[a], sortedX[b]); });
+	}
+	else
+		for (int k = 0; k < size(); k++)
+			if (ranksByY[k] >= lo && ranksByY[k] < hi)
+				ys.push_back(ranksByY[k]);
+	return solve(lo, hi, ys.data(), NULL);
+}
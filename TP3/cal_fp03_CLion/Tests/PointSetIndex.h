@@ -0,0 +1,70 @@
+/*
+ * PointSetIndex.h
+ */
+
+#ifndef POINTSETINDEX_H_
+#define POINTSETINDEX_H_
+
+#include <vector>
+#include "Point.h"
+#include "NearestPoints.h"
+
+using namespace std;
+
+class TaskPool;
+
+/*
+ * Set of points with their X and Y orders cached, so that repeated
+ * closest pair queries don't sort again. The orders are computed on the
+ * first query after a change of the points (set or add), with a radix
+ * sort; points are identified by their index in getPoints().
+ * Queries use the divide and conquer algorithm with presorted X and Y:
+ * each half gets its points in Y order by splitting those of its parent
+ * (a linear pass), so no query sorts anything.
+ */
+class PointSetIndex {
+	vector<Point> points;
+	vector<int> byX, byY;    // point indices, by X (ties by Y), and by Y (ties by X)
+	vector<int> rankX;       // position of each point in byX
+	vector<int> ranksByY;    // rankX of the points, in Y order
+	vector<Point> sortedX;   // the points in X order
+	bool sorted;
+
+	void sort();
+	Result solve(int lo, int hi, const int *ys, TaskPool *tasks);
+public:
+	PointSetIndex();
+	PointSetIndex(const vector<Point> &vp);
+
+	const vector<Point> &getPoints() const;
+	int size() const;
+
+	/**
+	 * Changes point i, or adds a point (returning its index). Either one
+	 * invalidates the cached orders.
+	 */
+	void set(int i, const Point &p);
+	int add(const Point &p);
+
+	/**
+	 * Point indices by X (ties by Y) and by Y (ties by X).
+	 */
+	const vector<int> &orderByX();
+	const vector<int> &orderByY();
+
+	/**
+	 * Closest pair of all the points; the _MT version uses the pool of
+	 * threads of the nearestPoints_*_MT functions.
+	 */
+	Result closest();
+	Result closest_MT();
+
+	/**
+	 * Closest pair of the points with minX <= x <= maxX. Their X order is
+	 * a range of the cached one; their Y order is filtered from the cached
+	 * one, or sorted if there are few of them.
+	 */
+	Result closestInRange(double minX, double maxX);
+};
+
+#endif /* POINTSETINDEX_H_ */
@@ -0,0 +1,153 @@
+/*
+ * PointSoA.cpp
+ */
+
+#include "PointSoA.h"
+
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+static const double INF = numeric_limits<double>::infinity();
+
+PointSoA::PointSoA() : xs(NULL), ys(NULL), n(0), capacity(0)
+{
+	allocate(0);
+}
+
+PointSoA::PointSoA(const vector<Point> &vp) : xs(NULL), ys(NULL), n(0), capacity(0)
+{
+	allocate(0);
+	assign(vp, 0, (int) vp.size() - 1);
+}
+
+PointSoA::PointSoA(const PointSoA &s) : xs(NULL), ys(NULL), n(0), capacity(0)
+{
+	allocate(0);
+	*this = s;
+}
+
+PointSoA &PointSoA::operator=(const PointSoA &s)
+{
+	if (this != &s)
+	{
+		if (s.n > capacity)
+			allocate(s.n);
+		n = s.n;
+		copy(s.xs, s.xs + n + PADDING, xs);
+		copy(s.ys, s.ys + n + PADDING, ys);
+	}
+	return *this;
+}
+
+/**
+ * New (uninitialized) storage for at least "capacity" points, plus the padding.
+ */
+void PointSoA::allocate(int capacity)
+{
+	const int perAlignment = ALIGNMENT / sizeof(double);
+	int slots = (capacity + PADDING + perAlignment - 1) / perAlignment * perAlignment;
+	vector<double>(2 * slots + perAlignment).swap(storage);
+	owner.reset();
+	uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+	uintptr_t offset = (ALIGNMENT - address % ALIGNMENT) % ALIGNMENT;
+	xs = storage.data() + offset / sizeof(double);
+	ys = xs + slots;
+	this->capacity = slots - PADDING;
+	fill(xs + n, xs + slots, INF);
+	fill(ys + n, ys + slots, INF);
+}
+
+void PointSoA::assign(const vector<Point> &vp, int left, int right)
+{
+	assign(vp.data() + left, max(right - left + 1, 0));
+}
+
+void PointSoA::assign(const Point *p, int count)
+{
+	if (count > capacity)
+	{
+		n = 0;
+		allocate(count);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		xs[i] = p[i].x;
+		ys[i] = p[i].y;
+	}
+	// Restore the padding over the old points, if there were more
+	for (int i = count; i < max(n, count) + PADDING; i++)
+		xs[i] = ys[i] = INF;
+	n = count;
+}
+
+void PointSoA::adopt(double *x, double *y, int n, shared_ptr<void> owner)
+{
+	vector<double>().swap(storage);
+	this->owner = owner;
+	xs = x;
+	ys = y;
+	this->n = n;
+	capacity = n;
+}
+
+void PointSoA::resize(int n)
+{
+	if (n > capacity)
+	{
+		vector<double> old;
+		old.swap(storage);
+		shared_ptr<void> oldOwner = owner;
+		const double *oldX = xs, *oldY = ys;
+		allocate(n);
+		copy(oldX, oldX + this->n, xs);
+		copy(oldY, oldY + this->n, ys);
+	}
+	for (int i = n; i < max(this->n, n) + PADDING; i++)
+		xs[i] = ys[i] = INF;
+	this->n = n;
+}
+
+int PointSoA::size() const
+{
+	return n;
+}
+
+double *PointSoA::x()
+{
+	return xs;
+}
+
+double *PointSoA::y()
+{
+	return ys;
+}
+
+const double *PointSoA::x() const
+{
+	return xs;
+}
+
+const double *PointSoA::y() const
+{
+	return ys;
+}
+
+Point PointSoA::get(int i) const
+{
+	return Point(xs[i], ys[i]);
+}
+
+void PointSoA::set(int i, const Point &p)
+{
+	xs[i] = p.x;
+	ys[i] = p.y;
+}
+
+void PointSoA::toVector(vector<Point> &vp) const
+{
+	vp.clear();
+	vp.reserve(n);
+	for (int i = 0; i < n; i++)
+		vp.push_back(Point(xs[i], ys[i]));
+}
@@ -0,0 +1,74 @@
+/*
+ * PointSoA.h
+ */
+
+#ifndef POINTSOA_H_
+#define POINTSOA_H_
+
+#include <vector>
+#include <memory>
+#include "Point.h"
+
+using namespace std;
+
+/*
+ * Set of points stored as a structure of arrays: all x coordinates in one
+ * array and all y coordinates in another, both aligned to ALIGNMENT bytes.
+ * SIMD code can then load the x (or y) coordinates of several consecutive
+ * points into one register with an aligned load, instead of gathering them
+ * from the interleaved coordinates of vector<Point>.
+ * After the last point there are always PADDING more slots holding
+ * +infinity, so that kernels may read a few slots past the end.
+ * The arrays may also live in memory owned by someone else, such as a
+ * mapped point file (see adopt).
+ */
+class PointSoA {
+	vector<double> storage; // both arrays, plus room for the alignment
+	shared_ptr<void> owner; // keeps external arrays alive, if in use
+	double *xs;
+	double *ys;
+	int n;
+	int capacity;
+
+	void allocate(int capacity);
+public:
+	static const int ALIGNMENT = 32; // bytes
+	static const int PADDING = 4;    // slots
+
+	PointSoA();
+	explicit PointSoA(const vector<Point> &vp);
+	PointSoA(const PointSoA &s);
+	PointSoA &operator=(const PointSoA &s);
+
+	/**
+	 * Replaces the contents by the points of vp between indices left and
+	 * right (inclusive), or by the "count" points of p. Memory is only
+	 * reallocated if it has to grow.
+	 */
+	void assign(const vector<Point> &vp, int left, int right);
+	void assign(const Point *p, int count);
+
+	/**
+	 * Uses the n points in the arrays x and y, kept alive by "owner", instead
+	 * of its own storage, without copying them. Both arrays must be aligned
+	 * and followed by PADDING slots of +infinity. Growing beyond n copies
+	 * the points back to own storage.
+	 */
+	void adopt(double *x, double *y, int n, shared_ptr<void> owner);
+
+	/**
+	 * Changes the number of points, keeping the first ones.
+	 */
+	void resize(int n);
+
+	int size() const;
+	double *x();
+	double *y();
+	const double *x() const;
+	const double *y() const;
+	Point get(int i) const;
+	void set(int i, const Point &p);
+	void toVector(vector<Point> &vp) const;
+};
+
+#endif /* POINTSOA_H_ */
@@ -0,0 +1,215 @@
+/*
+ * RadixSort.h
+ */
+
+#ifndef RADIXSORT_H_
+#define RADIXSORT_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "TaskPool.h"
+
+using namespace std;
+
+/*
+ * Unsigned integers ordered as the coordinates they come from: the sign
+ * bit of a float or double is flipped, and so are all the other bits of a
+ * negative one; -0.0 is taken as 0.0.
+ */
+inline uint64_t radixBits(double v)
+{
+	if (v == 0)
+		v = 0;
+	uint64_t b;
+	memcpy(&b, &v, sizeof(b));
+	return b >> 63 ? ~b : b | ((uint64_t) 1 << 63);
+}
+
+inline uint32_t radixBits(float v)
+{
+	if (v == 0)
+		v = 0;
+	uint32_t b;
+	memcpy(&b, &v, sizeof(b));
+	return b >> 31 ? ~b : b | ((uint32_t) 1 << 31);
+}
+
+inline uint32_t radixBits(int32_t v)
+{
+	return (uint32_t) v ^ ((uint32_t) 1 << 31);
+}
+
+/**
+ * Runs f(t) for t in [begin, end[, as tasks of "tasks" if not NULL.
+ */
+template <class F>
+void forEachTask(TaskPool *tasks, int begin, int end, const F &f)
+{
+	if (end - begin == 1 || tasks == NULL)
+	{
+		for (int t = begin; t < end; t++)
+			f(t);
+		return;
+	}
+	int middle = begin + (end - begin) / 2;
+	tasks->invoke([&]{ forEachTask(tasks, begin, middle, f); },
+			[&]{ forEachTask(tasks, middle, end, f); });
+}
+
+/**
+ * LSD radix sort of the n elements source(0) .. source(n - 1) into a, by
+ * bits(element), an unsigned integer of type Bits, one byte per pass,
+ * through "buffer" (as large as the array).
+ * The bytes of all the passes are counted in a single read of the source,
+ * and passes where all the elements have the same byte are skipped. The
+ * first pass reads the source, and the passes alternate between a and
+ * buffer so that the last one writes to a, unless "inPlace" (the source
+ * reads a itself), where the first pass must write to buffer.
+ * The array is split in chunks, one per thread of "tasks" (a single one if
+ * NULL), and each pass counts the bytes of every chunk and then scatters
+ * every chunk to its own positions, both in parallel.
+ */
+template <class Bits, class T, class Source, class GetBits>
+void radixPassesFrom(const Source &source, size_t n, T *a, T *buffer, TaskPool *tasks, const GetBits &bits,
+		bool inPlace = false)
+{
+	const int passes = sizeof(Bits);
+	int chunks = tasks == NULL ? 1 : max(1, min(tasks->getNumThreads(), (int) (n / 65536)));
+	auto chunkBegin = [&](int c) { return n * c / chunks; };
+
+	// counts[(pass * chunks + chunk) * 256 + byte]
+	vector<size_t> counts((size_t) passes * chunks * 256, 0);
+	forEachTask(tasks, 0, chunks, [&](int c) {
+		for (size_t i = chunkBegin(c); i < chunkBegin(c + 1); i++)
+		{
+			Bits b = bits(source(i));
+			for (int pass = 0; pass < passes; pass++)
+				counts[((size_t) pass * chunks + c) * 256 + ((b >> (8 * pass)) & 255)]++;
+		}
+	});
+
+	vector<int> needed;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		size_t *count = &counts[(size_t) pass * chunks * 256];
+		bool trivial = false;
+		for (int d = 0; d < 256 && !trivial; d++)
+		{
+			size_t k = 0;
+			for (int c = 0; c < chunks; c++)
+				k += count[c * 256 + d];
+			trivial = k == n;
+		}
+		if (!trivial)
+			needed.push_back(pass);
+	}
+	if (needed.empty())
+	{
+		if (!inPlace)
+			forEachTask(tasks, 0, chunks, [&](int c) {
+				for (size_t i = chunkBegin(c); i < chunkBegin(c + 1); i++)
+					a[i] = source(i);
+			});
+		return;
+	}
+
+	T *src = NULL, *dst = needed.size() % 2 == 1 && !inPlace ? a : buffer;
+	for (size_t k = 0; k < needed.size(); k++)
+	{
+		size_t *count = &counts[(size_t) needed[k] * chunks * 256];
+		int shift = 8 * needed[k];
+
+		// Counts by chunk are those of the initial order (the totals remain)
+		if (k > 0 && chunks > 1)
+		{
+			fill(count, count + chunks * 256, 0);
+			forEachTask(tasks, 0, chunks, [&](int c) {
+				for (size_t i = chunkBegin(c); i < chunkBegin(c + 1); i++)
+					count[c * 256 + ((bits(src[i]) >> shift) & 255)]++;
+			});
+		}
+
+		// Start of every byte value in every chunk, chunks in order
+		size_t total = 0;
+		for (int d = 0; d < 256; d++)
+			for (int c = 0; c < chunks; c++)
+			{
+				size_t m = count[c * 256 + d];
+				count[c * 256 + d] = total;
+				total += m;
+			}
+
+		forEachTask(tasks, 0, chunks, [&](int c) {
+			size_t *next = &count[c * 256];
+			if (k == 0)
+				for (size_t i = chunkBegin(c); i < chunkBegin(c + 1); i++)
+				{
+					T e = source(i);
+					dst[next[(bits(e) >> shift) & 255]++] = e;
+				}
+			else
+				for (size_t i = chunkBegin(c); i < chunkBegin(c + 1); i++)
+					dst[next[(bits(src[i]) >> shift) & 255]++] = src[i];
+		});
+		src = dst;
+		dst = src == a ? buffer : a;
+	}
+	if (src != a)
+		copy(src, src + n, a);
+}
+
+/**
+ * LSD radix sort of a[0..n[ by bits(a[i]), in place (see radixPassesFrom).
+ */
+template <class Bits, class T, class GetBits>
+void radixPasses(T *a, size_t n, T *buffer, TaskPool *tasks, const GetBits &bits)
+{
+	radixPassesFrom<Bits>([a](size_t i) -> const T & { return a[i]; }, n, a, buffer, tasks, bits, true);
+}
+
+// Runs of equal primary keys at least this long are radix sorted too
+const size_t RADIX_RUN_CUTOFF = 4096;
+
+/**
+ * Sorts the n elements source(0) .. source(n - 1) into a by the key
+ * (Key::primary(e), Key::secondary(e)), both coordinates of a type
+ * radixBits accepts, through "buffer" (as large as a): a radix sort by the
+ * primary coordinate, then every run of equal primary coordinates is
+ * sorted by the secondary one (with radixPasses if the run is long, such
+ * as when all the points have the same x). The source is only read once
+ * to count and once to scatter, so it may be in another layout than T.
+ */
+template <class Key, class T, class Source>
+void radixSortFrom(const Source &source, size_t n, T *a, T *buffer, TaskPool *tasks, bool inPlace = false)
+{
+	typedef decltype(radixBits(Key::primary(*a))) Bits1;
+	typedef decltype(radixBits(Key::secondary(*a))) Bits2;
+	auto primary = [](const T &e) { return radixBits(Key::primary(e)); };
+	auto secondary = [](const T &e) { return radixBits(Key::secondary(e)); };
+
+	radixPassesFrom<Bits1>(source, n, a, buffer, tasks, primary, inPlace);
+	for (size_t i = 0, j; i < n; i = j)
+	{
+		Bits1 run = primary(a[i]);
+		for (j = i + 1; j < n && primary(a[j]) == run; j++)
+			;
+		if (j - i >= RADIX_RUN_CUTOFF)
+			radixPasses<Bits2>(a + i, j - i, buffer, tasks, secondary);
+		else if (j - i > 1)
+			sort(a + i, a + j, [&](const T &p, const T &q) { return secondary(p) < secondary(q); });
+	}
+}
+
+/**
+ * Sorts a[0..n[ in place, as radixSortFrom.
+ */
+template <class Key, class T>
+void radixSort(T *a, size_t n, TaskPool *tasks)
+{
+	vector<T> buffer(n);
+	radixSortFrom<Key>([a](size_t i) -> const T & { return a[i]; }, n, a, buffer.data(), tasks, true);
+}
+
+#endif /* RADIXSORT_H_ */
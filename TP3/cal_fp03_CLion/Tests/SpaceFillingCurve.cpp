@@ -0,0 +1,101 @@
+/*
+ * SpaceFillingCurve.cpp
+ */
+
+#include "SpaceFillingCurve.h"
+
+#include <algorithm>
+#include "RadixSort.h"
+#include "TaskPool.h"
+
+/*
+ * A point with its position along the curve.
+ */
+template <class Scalar>
+struct CurvePoint {
+	uint32_t key;
+	PointT<Scalar> p;
+};
+
+/**
+ * The bits of v, at the even positions of the result.
+ */
+static uint32_t spreadBits(uint16_t v)
+{
+	uint32_t b = v;
+	b = (b | b << 8) & 0x00FF00FF;
+	b = (b | b << 4) & 0x0F0F0F0F;
+	b = (b | b << 2) & 0x33333333;
+	b = (b | b << 1) & 0x55555555;
+	return b;
+}
+
+uint32_t mortonKey(uint16_t x, uint16_t y)
+{
+	return spreadBits(x) | spreadBits(y) << 1;
+}
+
+uint32_t hilbertKey(uint16_t x, uint16_t y)
+{
+	uint32_t d = 0, cx = x, cy = y;
+	for (uint32_t s = 1 << 15; s > 0; s >>= 1)
+	{
+		uint32_t rx = (cx & s) != 0, ry = (cy & s) != 0;
+		d += s * s * ((3 * rx) ^ ry);
+		// Turns the quadrant so that the curve inside it starts at its corner
+		// (only the bits below s matter from now on), without branches:
+		// mirrored if rx and not ry, then transposed if not ry
+		uint32_t mirror = 0 - (rx & (ry ^ 1)), transpose = 0 - (ry ^ 1);
+		cx ^= mirror;
+		cy ^= mirror;
+		uint32_t t = (cx ^ cy) & transpose;
+		cx ^= t;
+		cy ^= t;
+	}
+	return d;
+}
+
+template <class Scalar>
+void sortByCurve(vector<PointT<Scalar> > &vp, CurveOrder order, TaskPool *tasks)
+{
+	size_t n = vp.size();
+	if (order == CURVE_NONE || n < 2)
+		return;
+	double minX = vp[0].x, maxX = minX, minY = vp[0].y, maxY = minY;
+	for (size_t i = 1; i < n; i++)
+	{
+		minX = min(minX, (double) vp[i].x);
+		maxX = max(maxX, (double) vp[i].x);
+		minY = min(minY, (double) vp[i].y);
+		maxY = max(maxY, (double) vp[i].y);
+	}
+	// Same scale on both axes, so that cells are squares
+	double extent = max(maxX - minX, maxY - minY);
+	double scale = extent > 0 ? 65535.0 / extent : 0;
+	auto cell = [scale](double v, double origin) {
+		return (uint16_t) min((v - origin) * scale, 65535.0);
+	};
+
+	vector<CurvePoint<Scalar> > items(n);
+	int chunks = tasks == NULL ? 1 : max(1, min(tasks->getNumThreads(), (int) (n / 65536)));
+	forEachTask(tasks, 0, chunks, [&](int c) {
+		for (size_t i = n * c / chunks; i < n * (c + 1) / chunks; i++)
+		{
+			uint16_t x = cell(vp[i].x, minX), y = cell(vp[i].y, minY);
+			items[i].key = order == CURVE_MORTON ? mortonKey(x, y) : hilbertKey(x, y);
+			items[i].p = vp[i];
+		}
+	});
+	vector<CurvePoint<Scalar> > buffer(n);
+	radixPasses<uint32_t>(items.data(), n, buffer.data(), tasks,
+			[](const CurvePoint<Scalar> &e) { return e.key; });
+	forEachTask(tasks, 0, chunks, [&](int c) {
+		for (size_t i = n * c / chunks; i < n * (c + 1) / chunks; i++)
+			vp[i] = items[i].p;
+	});
+}
+
+// Supported coordinate types
+template void sortByCurve(vector<PointT<int32_t> > &vp, CurveOrder order, TaskPool *tasks);
+template void sortByCurve(vector<PointT<float> > &vp, CurveOrder order, TaskPool *tasks);
+template void sortByCurve(vector<PointT<double> > &vp, CurveOrder order, TaskPool *tasks);
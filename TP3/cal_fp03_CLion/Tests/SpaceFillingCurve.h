@@ -0,0 +1,42 @@
+/*
+ * SpaceFillingCurve.h
+ */
+
+#ifndef SPACEFILLINGCURVE_H_
+#define SPACEFILLINGCURVE_H_
+
+#include <vector>
+#include <cstdint>
+#include "Point.h"
+
+using namespace std;
+
+class TaskPool;
+
+/*
+ * Orders of the points along a space-filling curve: points close along
+ * the curve are close in the plane, so algorithms that visit the points
+ * in the order of the array (grids, kd-trees, brute force) touch memory
+ * that is close too.
+ * Morton (Z) order interleaves the bits of the coordinates; Hilbert order
+ * is slower to compute but has no long jumps between consecutive cells.
+ */
+enum CurveOrder { CURVE_NONE, CURVE_MORTON, CURVE_HILBERT };
+
+/**
+ * Position along the curve of the cell (x, y) of a 2^16 x 2^16 grid.
+ */
+uint32_t mortonKey(uint16_t x, uint16_t y);
+uint32_t hilbertKey(uint16_t x, uint16_t y);
+
+/**
+ * Reorders vp along the curve (unchanged for CURVE_NONE). The bounding
+ * square of the points is mapped to the 2^16 x 2^16 grid (much finer than
+ * the spacing of the points for any practical size), and the points are
+ * radix sorted by the key of their cell, in 4 passes. Keys are computed, and the
+ * sort runs, on the threads of "tasks" if not NULL (such as getPool()).
+ * Instantiated for int32_t, float and double coordinates.
+ */
+template <class Scalar> void sortByCurve(vector<PointT<Scalar> > &vp, CurveOrder order, TaskPool *tasks);
+
+#endif /* SPACEFILLINGCURVE_H_ */
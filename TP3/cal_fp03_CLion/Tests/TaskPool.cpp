@@ -0,0 +1,151 @@
+/*
+ * TaskPool.cpp
+ */
+
+#include "TaskPool.h"
+
+// Pool and queue of the calling thread, if it is a worker of some pool
+static thread_local const TaskPool *currentPool = NULL;
+static thread_local int currentIndex = 0;
+
+TaskPool::TaskPool(int numThreads) :
+		numThreads(numThreads < 1 ? 1 : numThreads), queues(this->numThreads), pending(0), stopping(false)
+{
+	for (int q = 1; q < this->numThreads; q++)
+		workers.push_back(thread(&TaskPool::workerLoop, this, q));
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		lock_guard<mutex> guard(idleLock);
+		stopping = true;
+	}
+	idle.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+int TaskPool::getNumThreads() const
+{
+	return numThreads;
+}
+
+int TaskPool::currentQueue() const
+{
+	return currentPool == this ? currentIndex : 0;
+}
+
+void TaskPool::push(int q, Task *t)
+{
+	{
+		lock_guard<mutex> guard(queues[q].lock);
+		queues[q].tasks.push_back(t);
+	}
+	pending++;
+	{
+		// Taking the lock makes sure no worker misses the notification
+		lock_guard<mutex> guard(idleLock);
+	}
+	idle.notify_one();
+}
+
+/**
+ * Removes t from the back of queue q, unless some other thread took it.
+ */
+bool TaskPool::popOwn(int q, Task *t)
+{
+	lock_guard<mutex> guard(queues[q].lock);
+	if (queues[q].tasks.empty() || queues[q].tasks.back() != t)
+		return false;
+	queues[q].tasks.pop_back();
+	pending--;
+	return true;
+}
+
+/**
+ * Newest task of queue q or, if there is none, oldest task of another queue.
+ */
+TaskPool::Task *TaskPool::take(int q)
+{
+	if (pending == 0)
+		return NULL;
+	for (int k = 0; k < numThreads; k++)
+	{
+		Queue &queue = queues[(q + k) % numThreads];
+		lock_guard<mutex> guard(queue.lock);
+		if (queue.tasks.empty())
+			continue;
+		Task *t;
+		if (k == 0)
+		{
+			t = queue.tasks.back();
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			t = queue.tasks.front();
+			queue.tasks.pop_front();
+		}
+		pending--;
+		return t;
+	}
+	return NULL;
+}
+
+void TaskPool::execute(Task *t)
+{
+	t->run();
+	t->done = true;
+}
+
+void TaskPool::workerLoop(int q)
+{
+	currentPool = this;
+	currentIndex = q;
+	while (true)
+	{
+		Task *t = take(q);
+		if (t != NULL)
+		{
+			execute(t);
+			continue;
+		}
+		unique_lock<mutex> lock(idleLock);
+		idle.wait(lock, [this]{ return stopping || pending > 0; });
+		if (stopping && pending == 0)
+			return;
+	}
+}
+
+void TaskPool::invoke(const function<void()> &a, const function<void()> &b)
+{
+	if (numThreads == 1)
+	{
+		a();
+		b();
+		return;
+	}
+
+	Task tb;
+	tb.run = b;
+	tb.done = false;
+	int q = currentQueue();
+	push(q, &tb);
+	a();
+	if (popOwn(q, &tb))
+	{
+		b();
+		return;
+	}
+
+	// b was stolen: help with other tasks until it is done
+	while (!tb.done)
+	{
+		Task *t = take(q);
+		if (t != NULL)
+			execute(t);
+		else
+			this_thread::yield();
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * TaskPool.h
+ */
+
+#ifndef TASKPOOL_H_
+#define TASKPOOL_H_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+/*
+ * Persistent pool of threads for fork-join parallelism, with work stealing.
+ * Every worker has its own deque of tasks: it runs the newest task of its
+ * own deque first, and when that is empty steals the oldest task of another
+ * deque (usually the largest piece of work left).
+ */
+class TaskPool {
+	struct Task {
+		function<void()> run;
+		atomic<bool> done;
+	};
+
+	struct Queue {
+		mutex lock;
+		deque<Task *> tasks;
+	};
+
+	int numThreads;
+	vector<Queue> queues; // queue 0 is used by threads outside the pool
+	vector<thread> workers;
+	mutex idleLock;
+	condition_variable idle;
+	atomic<int> pending; // tasks waiting in the queues
+	bool stopping;
+
+	int currentQueue() const;
+	void push(int q, Task *t);
+	bool popOwn(int q, Task *t);
+	Task *take(int q);
+	void execute(Task *t);
+	void workerLoop(int q);
+public:
+	/**
+	 * Creates a pool where numThreads threads (the calling thread included)
+	 * share the work, i.e. numThreads - 1 background workers.
+	 */
+	TaskPool(int numThreads);
+	~TaskPool();
+	int getNumThreads() const;
+
+	/**
+	 * Runs a and b, possibly in parallel, and returns when both are done.
+	 * b is offered to the other threads while the caller runs a; if nobody
+	 * took it meanwhile, the caller runs it too. While waiting, the caller
+	 * helps with other tasks of the pool.
+	 */
+	void invoke(const function<void()> &a, const function<void()> &b);
+};
+
+#endif /* TASKPOOL_H_ */
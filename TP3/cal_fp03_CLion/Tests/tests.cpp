@@ -6,6 +6,18 @@
 #include <sys/timeb.h>
 #include "Point.h"
 #include "NearestPoints.h"
+#include "PointSoA.h"
+#include "PointFile.h"
+#include "KdTree.h"
+#include "ExternalNearestPoints.h"
+#include "DynamicNearestPoints.h"
+#include "NearestPointsND.h"
+#include "RadixSort.h"
+#include "MultiProcessNearestPoints.h"
+#include "ApproxNearestPoints.h"
+#include "PointSetIndex.h"
+#include "SpaceFillingCurve.h"
+#include "PointGenerator.h"
 #include <random>
 #include <stdlib.h>
 
@@ -16,86 +28,7 @@ using testing::Eq;
  * Auxiliary function to read points from file to vector.
  */
 void readPoints(string in, vector<Point> &vp){
-    ifstream is(in.c_str());
-    vp.clear();
-    if (!is)
-        return;
-    while (!is.eof()) {
-        double x, y;
-        is >> x >> y;
-        Point p(x,y);
-        vp.push_back(p);
-    }
-}
-
-/**
- * Auxiliary functions to generate random sets of points.
- */
-
-void shuffle(vector<Point> &vp, int left, int right)
-{
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis(0, right - left +1);
-    for (int i = left; i < right; i++){
-        int k = i + dis(gen) % (right - i + 1);
-        Point tmp = vp[i];
-        vp[i] = vp[k];
-        vp[k] = tmp;
-    }
-}
-
-void shuffleY(vector<Point> &vp, int left, int right)
-{
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis(0, right - left +1);
-    for (int i = left; i < right; i++){
-        int k = i + dis(gen) % (right - i + 1);
-        double tmp = vp[i].y;
-        vp[i].y = vp[k].y;
-        vp[k].y = tmp;
-    }
-}
-
-// Generates a vector of n distinct points with minimum distance 1.
-void generateRandom(int n, vector<Point> &vp) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis(0, n-1);
-
-    vp.clear();
-    // reference value for reference points (r, r), (r, r+1)
-    int r = dis(gen);
-    vp.push_back(Point(r,r));
-    vp.push_back(Point(r,r+1));
-    for (int i = 2; i < n; i++)
-        if (i < r)
-            vp.push_back(Point(i, i));
-        else
-            vp.push_back(Point(i+1, i+2));
-    shuffleY(vp, 2, n-1);
-    shuffle(vp, 0, n-1);
-}
-
-// Similar, but with constant X.
-void generateRandomConstX(int n, vector<Point> &vp) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis(0, n-1);
-
-    vp.clear();
-    // reference value for min dist
-    int r = dis(gen);
-    int y = 0;
-    for (int i = 0; i < n; i++) {
-        vp.push_back(Point(0, y));
-        if (i == r)
-            y++;
-        else
-            y += 1 + dis(gen) % 100;
-    }
-    shuffleY(vp, 0, n-1);
+    readPointText(in, vp);
 }
 
 /**
@@ -235,4 +168,655 @@ TEST(CAL_FP03, testNP_DC_8Threads) {
 }
 
 
+TEST(CAL_FP03, testNP_DC_PoolConfig) {
+    PoolConfig config = getPoolConfig();
+    vector<Point> pontos;
+    generateRandom(0x10000, pontos);
+    vector<Point> copy = pontos;
+    Result expected = nearestPoints_DC(copy);
+
+    // Tiny cutoff, so that the recursion is split in many small tasks
+    setPoolConfig(PoolConfig(4, 16));
+    Result res = nearestPoints_DC_MT(pontos);
+    EXPECT_EQ(expected.dmin, res.dmin);
+    EXPECT_EQ(4, getPoolConfig().numThreads);
+
+    // Same pool, now with a cutoff larger than the input: sequential
+    setPoolConfig(PoolConfig(4, 0x20000));
+    res = nearestPoints_DC_MT(pontos);
+    EXPECT_EQ(expected.dmin, res.dmin);
+
+    setPoolConfig(config);
+}
+
+
+TEST(CAL_FP03, testPointSoA) {
+    vector<Point> pontos;
+    generateRandom(1000, pontos);
+    PointSoA soa(pontos);
+    EXPECT_EQ(1000, soa.size());
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(soa.x()) % PointSoA::ALIGNMENT);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(soa.y()) % PointSoA::ALIGNMENT);
+    for (int i = 0; i < soa.size(); i++)
+        EXPECT_TRUE(soa.get(i) == pontos[i]);
+
+    // Padding after the last point, also after shrinking
+    soa.assign(pontos, 10, 19);
+    EXPECT_EQ(10, soa.size());
+    EXPECT_TRUE(soa.get(0) == pontos[10]);
+    for (int i = 10; i < 10 + PointSoA::PADDING; i++)
+        EXPECT_TRUE(std::isinf(soa.x()[i]) && std::isinf(soa.y()[i]));
+
+    PointSoA copy = soa;
+    vector<Point> back;
+    copy.toVector(back);
+    EXPECT_EQ(vector<Point>(pontos.begin() + 10, pontos.begin() + 20), back);
+
+    // Copies of an empty set, with their padding
+    PointSoA empty;
+    PointSoA emptyCopy(empty);
+    EXPECT_EQ(0, emptyCopy.size());
+    EXPECT_TRUE(std::isinf(emptyCopy.x()[0]) && std::isinf(emptyCopy.y()[0]));
+    copy = empty;
+    EXPECT_EQ(0, copy.size());
+}
+
+
+TEST(CAL_FP03, testNP_DC_Merge) {
+    testNearestPoints(nearestPoints_DC_Merge, "Divide and conquer, merging by y");
+}
+
+
+TEST(CAL_FP03, testNP_DC_Merge_4Threads) {
+    setNumThreads(4);
+    testNearestPoints(nearestPoints_DC_Merge_MT, "Divide and conquer, merging by y, with 4 threads");
+}
+
+
+TEST(CAL_FP03, testNP_Grid) {
+    testNearestPoints(nearestPoints_Grid, "Randomized grid hashing");
+}
+
+
+TEST(CAL_FP03, testPointFile) {
+    vector<Point> pontos;
+    readPoints("Pontos16k", pontos);
+    string file = "Pontos16k.tmp.bin";
+    EXPECT_TRUE(convertPointFile("Pontos16k", file));
+
+    PointSoA mapped;
+    EXPECT_TRUE(loadPointFile(file, mapped));
+    remove(file.c_str()); // the mapping stays valid
+    EXPECT_EQ((int) pontos.size(), mapped.size());
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(mapped.x()) % PointSoA::ALIGNMENT);
+    EXPECT_TRUE(std::isinf(mapped.x()[mapped.size()]));
+    vector<Point> loaded;
+    mapped.toVector(loaded);
+    EXPECT_EQ(pontos, loaded);
+    EXPECT_NEAR(13.0384, nearestPoints_DC(loaded).dmin, 0.01);
+
+    // Straight on the mapping, which is left as it is
+    double expected = nearestPoints_DC_Merge(loaded).dmin;
+    EXPECT_EQ(expected, nearestPoints_DC_Merge(mapped).dmin);
+    setNumThreads(4);
+    EXPECT_EQ(expected, nearestPoints_DC_Merge_MT(mapped).dmin);
+    setNumThreads(1);
+    mapped.toVector(loaded);
+    EXPECT_EQ(pontos, loaded);
+    EXPECT_EQ(Result().dmin, nearestPoints_DC_Merge(PointSoA()).dmin);
+
+    EXPECT_FALSE(loadPointFile("Pontos16k", mapped)); // text, not binary
+    EXPECT_FALSE(loadPointFile("missing.bin", mapped));
+    EXPECT_EQ((int) pontos.size(), mapped.size());
+
+    // Corrupted files: writes "bytes" at "offset" of a valid file of 10 points
+    vector<Point> few(10, Point(1, 2));
+    PointFileHeader header;
+    auto corrupt = [&](uint64_t offset, const void *bytes, size_t length) {
+        EXPECT_TRUE(writePointFile(file, few));
+        fstream patch(file.c_str(), ios::in | ios::out | ios::binary);
+        patch.seekp(offset);
+        patch.write(static_cast<const char *>(bytes), length);
+    };
+    EXPECT_TRUE(writePointFile(file, few));
+    EXPECT_TRUE(readPointFileHeader(file, header));
+    PointFileHeader valid = header;
+
+    // An offset so large that offset + array size wraps around to a small value
+    uint64_t arrayBytes = (header.count + header.padding) * sizeof(double);
+    header.xOffset = 0 - arrayBytes / POINT_FILE_ALIGNMENT * POINT_FILE_ALIGNMENT;
+    corrupt(0, &header, sizeof(header));
+    EXPECT_FALSE(readPointFileHeader(file, header));
+    EXPECT_FALSE(loadPointFile(file, mapped));
+
+    // An array over the header
+    header = valid;
+    header.yOffset = 0;
+    corrupt(0, &header, sizeof(header));
+    EXPECT_FALSE(readPointFileHeader(file, header));
+    EXPECT_FALSE(loadPointFile(file, mapped));
+
+    // Finite padding after either array
+    double finite = 1e300;
+    corrupt(valid.xOffset + valid.count * sizeof(double), &finite, sizeof(finite));
+    EXPECT_FALSE(loadPointFile(file, mapped));
+    corrupt(valid.yOffset + (valid.count + PointSoA::PADDING - 1) * sizeof(double), &finite, sizeof(finite));
+    EXPECT_FALSE(loadPointFile(file, mapped));
+    EXPECT_EQ((int) pontos.size(), mapped.size());
+    remove(file.c_str());
+}
+
+
+TEST(CAL_FP03, testReadPointText) {
+    string file = "points.tmp.txt";
+    ofstream os(file.c_str());
+    // Pairs split over lines, as in the Pontos files, and mixed formats
+    os << "1\n2\n3.5 -4\n\n  +5e2\t6\r\n7 8\n9";
+    os.close();
+    for (int threads = 1; threads <= 8; threads++) {
+        vector<Point> pontos;
+        EXPECT_TRUE(readPointText(file, pontos, threads));
+        vector<Point> expected = {Point(1, 2), Point(3.5, -4.0), Point(500, 6), Point(7, 8)};
+        EXPECT_EQ(expected, pontos);
+    }
+
+    os.open(file.c_str());
+    os << "1 2\n3 x\n";
+    os.close();
+    vector<Point> pontos;
+    EXPECT_FALSE(readPointText(file, pontos, 2));
+    EXPECT_TRUE(pontos.empty());
+    remove(file.c_str());
+
+    // Same points with any number of threads
+    vector<Point> one, many;
+    readPointText("Pontos128k", one, 1);
+    readPointText("Pontos128k", many, 7);
+    EXPECT_EQ(0x20000u, one.size());
+    EXPECT_EQ(one, many);
+}
+
+
+TEST(CAL_FP03, testKdTree) {
+    std::mt19937 gen(38);
+    std::uniform_int_distribution<int> dis(0, 999);
+    vector<Point> pontos, queries;
+    for (int i = 0; i < 20000; i++)
+        pontos.push_back(Point(dis(gen), dis(gen)));
+    for (int i = 0; i < 1000; i++)
+        queries.push_back(Point(dis(gen) + 0.5, dis(gen) + 0.25));
+
+    // In parallel, down to parts of 256 points or queries
+    PoolConfig config = getPoolConfig();
+    setPoolConfig(PoolConfig(4, 256));
+    KdTree tree(pontos, 8);
+    EXPECT_EQ(20000, tree.size());
+    int k = 5;
+    double radius = 6;
+    vector<int> batch, limited;
+    tree.kNearest(queries, k, batch);
+    tree.kNearest(queries, k, limited, radius);
+    for (size_t q = 0; q < queries.size(); q++) {
+        // Brute force reference: squared distances, sorted
+        vector<double> dists;
+        for (size_t i = 0; i < pontos.size(); i++)
+            dists.push_back(queries[q].distSquare(pontos[i]));
+        partial_sort(dists.begin(), dists.begin() + k, dists.end());
+
+        EXPECT_EQ(dists[0], queries[q].distSquare(pontos[tree.nearest(queries[q])]));
+        vector<int> knn = tree.kNearest(queries[q], k);
+        ASSERT_EQ(k, (int) knn.size());
+        for (int j = 0; j < k; j++) {
+            EXPECT_EQ(dists[j], queries[q].distSquare(pontos[knn[j]]));
+            EXPECT_EQ(knn[j], batch[q * k + j]);
+            bool inside = dists[j] <= radius * radius;
+            EXPECT_EQ(inside ? knn[j] : -1, limited[q * k + j]);
+        }
+    }
+    EXPECT_EQ(-1, tree.nearest(Point(5000, 5000), 10.0));
+    EXPECT_TRUE(tree.kNearest(queries[0], 0).empty());
+    EXPECT_TRUE(tree.kNearest(queries[0], -1).empty());
+    setPoolConfig(config);
+}
+
 
+TEST(CAL_FP03, testNP_ScalarTypes) {
+    // Squared distances 2^60 and 2^60 - 11: equal as doubles, exact as integers
+    const int32_t h = 1 << 29;
+    vector<PointI> grid = {PointI(-h, 600000000), PointI(h, 600000000),
+                           PointI(-h, -600000000), PointI(h - 62, -600000000 + 364889)};
+    vector<PointI> copy = grid;
+    ResultT<int32_t> r = nearestPoints_DC(copy);
+    EXPECT_EQ((int64_t) (1LL << 60) - 11, r.p1.distSquare(r.p2));
+    copy = grid;
+    r = nearestPoints_DC_Merge(copy);
+    EXPECT_EQ((int64_t) (1LL << 60) - 11, r.p1.distSquare(r.p2));
+    copy = grid;
+    r = nearestPoints_Grid(copy);
+    EXPECT_EQ((int64_t) (1LL << 60) - 11, r.p1.distSquare(r.p2));
+
+    // Same answers as with double coordinates
+    vector<Point> pontos;
+    readPoints("Pontos16k", pontos);
+    vector<PointI> ints;
+    vector<PointF> floats;
+    for (size_t i = 0; i < pontos.size(); i++) {
+        ints.push_back(PointI((int32_t) pontos[i].x, (int32_t) pontos[i].y));
+        floats.push_back(PointF((float) pontos[i].x, (float) pontos[i].y));
+    }
+    EXPECT_NEAR(13.0384, nearestPoints_DC(ints).dmin, 0.01);
+    EXPECT_NEAR(13.0384, nearestPoints_DC_Merge(floats).dmin, 0.01);
+    EXPECT_NEAR(13.0384, nearestPoints_Grid(floats).dmin, 0.01);
+    setNumThreads(2);
+    EXPECT_NEAR(13.0384, nearestPoints_DC_MT(ints).dmin, 0.01);
+    EXPECT_NEAR(13.0384, nearestPoints_DC_Merge_MT(floats).dmin, 0.01);
+}
+
+
+TEST(CAL_FP03, testNP_External) {
+    // A 64 KB budget: runs of 2730 points, merged 3 at a time, slabs of 819
+    ExternalConfig config(64 << 10);
+    vector<Point> pontos, copy;
+    Result res;
+    generateRandom(20000, pontos, 41);
+    ASSERT_TRUE(writePointFile("External.tmp", pontos));
+    ASSERT_TRUE(nearestPoints_External("External.tmp", res, config));
+    copy = pontos;
+    Result expected = nearestPoints_DC_Merge(copy);
+    EXPECT_EQ(expected.dmin, res.dmin);
+    EXPECT_EQ(res.dmin, res.p1.distance(res.p2));
+
+    // Closest pairs across slabs, and in long runs of equal X
+    generateRandomConstX(5000, pontos, 41);
+    ASSERT_TRUE(writePointFile("External.tmp", pontos));
+    ASSERT_TRUE(nearestPoints_External("External.tmp", res, config));
+    copy = pontos;
+    EXPECT_EQ(nearestPoints_DC_Merge(copy).dmin, res.dmin);
+
+    // All the points with the same X, in 25 slabs: each boundary only reads
+    // the points of the previous right strips next to it in Y
+    ExternalStats stats;
+    generateRandomConstX(20000, pontos, 43);
+    ASSERT_TRUE(writePointFile("External.tmp", pontos));
+    ASSERT_TRUE(nearestPoints_External("External.tmp", res, config, &stats));
+    copy = pontos;
+    EXPECT_EQ(nearestPoints_DC_Merge(copy).dmin, res.dmin);
+    EXPECT_EQ(25u, stats.slabs);
+    EXPECT_LT(stats.boundaryPoints, 100u);
+
+    pontos.clear();
+    for (int i = 0; i < 3000; i++)
+        pontos.push_back(Point(i * 10, i % 2));
+    pontos.push_back(Point(8183, 0)); // starts the 2nd slab, 3 away from the end of the 1st
+    ASSERT_TRUE(writePointFile("External.tmp", pontos));
+    ASSERT_TRUE(nearestPoints_External("External.tmp", res, config));
+    EXPECT_EQ(3.0, res.dmin);
+
+    remove("External.tmp");
+    EXPECT_FALSE(nearestPoints_External("External.tmp", res, config));
+}
+
+
+TEST(CAL_FP03, testNP_Dynamic) {
+    vector<Point> pontos, copy;
+    readPoints("Pontos16k", pontos);
+    DynamicNearestPoints dyn;
+    EXPECT_EQ(numeric_limits<double>::max(), dyn.closest().dmin);
+    vector<int> ids;
+    for (size_t i = 0; i < pontos.size(); i++)
+        ids.push_back(dyn.insert(pontos[i]));
+    EXPECT_EQ((int) pontos.size(), dyn.size());
+    copy = pontos;
+    EXPECT_EQ(nearestPoints_DC(copy).dmin, dyn.closest().dmin);
+
+    // Erase one point of the closest pair, then a random half
+    std::mt19937 gen(42);
+    for (int round = 0; round < 10; round++) {
+        Result res = dyn.closest();
+        EXPECT_EQ(res.dmin, res.p1.distance(res.p2));
+        size_t i = find(pontos.begin(), pontos.end(), round % 2 ? res.p1 : res.p2) - pontos.begin();
+        ASSERT_TRUE(dyn.erase(ids[i]));
+        EXPECT_FALSE(dyn.erase(ids[i]));
+        pontos.erase(pontos.begin() + i);
+        ids.erase(ids.begin() + i);
+        copy = pontos;
+        EXPECT_EQ(nearestPoints_DC(copy).dmin, dyn.closest().dmin);
+    }
+    vector<Point> kept;
+    for (size_t i = 0; i < pontos.size(); i++) {
+        if (gen() % 2)
+            dyn.erase(ids[i]);
+        else
+            kept.push_back(pontos[i]);
+    }
+    EXPECT_EQ((int) kept.size(), dyn.size());
+    copy = kept;
+    EXPECT_EQ(nearestPoints_DC(copy).dmin, dyn.closest().dmin);
+
+    // Points on a line, and ids reused after erasing
+    generateRandomConstX(4000, pontos, 42);
+    DynamicNearestPoints line;
+    for (size_t i = 0; i < pontos.size(); i++)
+        line.insert(pontos[i]);
+    copy = pontos;
+    EXPECT_EQ(nearestPoints_DC(copy).dmin, line.closest().dmin);
+    for (int id = 0; id < 3990; id++)
+        line.erase(id);
+    line.insert(Point(pontos[3999].x, pontos[3999].y + 0.25));
+    EXPECT_EQ(0.25, line.closest().dmin);
+}
+
+
+/**
+ * Brute force reference for the PointND tests.
+ */
+template <int D, class Scalar>
+typename PointND<D, Scalar>::dist_type closestND_BF(const vector<PointND<D, Scalar> > &vp) {
+    typename PointND<D, Scalar>::dist_type best = numeric_limits<typename PointND<D, Scalar>::dist_type>::max();
+    for (size_t i = 0; i < vp.size(); i++)
+        for (size_t j = i + 1; j < vp.size(); j++)
+            best = min(best, vp[i].distSquare(vp[j]));
+    return best;
+}
+
+TEST(CAL_FP03, testNP_PointND) {
+    // Same answer as the 2-D algorithms
+    vector<Point> pontos;
+    readPoints("Pontos16k", pontos);
+    vector<PointND<2, double> > plane;
+    for (size_t i = 0; i < pontos.size(); i++)
+        plane.push_back(PointND<2, double>(pontos[i].x, pontos[i].y));
+    EXPECT_NEAR(13.0384, nearestPointsND_DC(plane).dmin, 0.01);
+
+    std::mt19937 gen(43);
+    uniform_real_distribution<double> coord(-1000, 1000);
+    vector<Point3> space(3000);
+    for (size_t i = 0; i < space.size(); i++)
+        space[i] = Point3(coord(gen), coord(gen), coord(gen));
+    double expected = closestND_BF(space);
+    ResultND<3, double> r = nearestPointsND_DC(space);
+    EXPECT_EQ(expected, r.p1.distSquare(r.p2));
+    EXPECT_EQ(sqrt(expected), r.dmin);
+    setNumThreads(4);
+    r = nearestPointsND_DC_MT(space);
+    EXPECT_EQ(expected, r.p1.distSquare(r.p2));
+
+    // Exact integer distances in 4 dimensions, with points equal in the split coordinate
+    uniform_int_distribution<int32_t> big(-(1 << 28), 1 << 28);
+    vector<PointND<4, int32_t> > ints(2000);
+    for (size_t i = 0; i < ints.size(); i++)
+        ints[i] = PointND<4, int32_t>(i % 3 ? big(gen) : 7, big(gen), big(gen), big(gen));
+    int64_t exact = closestND_BF(ints);
+    ResultND<4, int32_t> ri = nearestPointsND_DC(ints);
+    EXPECT_EQ(exact, ri.p1.distSquare(ri.p2));
+
+    // Degenerate sets: the split and scan coordinates don't separate the points
+    vector<Point3> line;
+    for (int k = 0; k < 20000; k++)
+        line.push_back(Point3(0, 0, k));
+    line.push_back(Point3(0, 0, 500.25));
+    EXPECT_EQ(0.25, nearestPointsND_DC(line).dmin);
+    vector<Point3> plane3(3000);
+    for (size_t i = 0; i < plane3.size(); i++)
+        plane3[i] = Point3(5, i % 2 ? 1.0 : coord(gen), coord(gen));
+    expected = closestND_BF(plane3);
+    r = nearestPointsND_DC(plane3);
+    EXPECT_EQ(expected, r.p1.distSquare(r.p2));
+    vector<PointND<4, int32_t> > line4;
+    for (int k = 0; k < 10000; k++)
+        line4.push_back(PointND<4, int32_t>(1, 2, 3, 3 * k));
+    EXPECT_EQ(3.0, nearestPointsND_DC(line4).dmin);
+}
+
+
+struct RadixKeyYX {
+    static double primary(const Point &p) { return p.y; }
+    static double secondary(const Point &p) { return p.x; }
+};
+
+struct RadixKeyInt {
+    static int32_t primary(const PointI &p) { return p.x; }
+    static int32_t secondary(const PointI &p) { return p.y; }
+};
+
+TEST(CAL_FP03, testRadixSort) {
+    // Negative values, zeros of both signs, infinities, and long runs of equal keys
+    std::mt19937 gen(44);
+    vector<Point> pontos;
+    for (int i = 0; i < 50000; i++) {
+        double y = i % 5 == 0 ? 3.0 : (double) (int32_t) gen() / 1024;
+        pontos.push_back(Point((double) (int32_t) gen() / 7, y));
+    }
+    pontos.push_back(Point(1, 0.0));
+    pontos.push_back(Point(0, -0.0));
+    pontos.push_back(Point(2, -numeric_limits<double>::infinity()));
+    pontos.push_back(Point(2, numeric_limits<double>::infinity()));
+    auto lessYX = [](const Point &p, const Point &q) { return p.y < q.y || (p.y == q.y && p.x < q.x); };
+    vector<Point> expected = pontos;
+    sort(expected.begin(), expected.end(), lessYX);
+    vector<Point> sorted = pontos;
+    radixSort<RadixKeyYX>(sorted.data(), sorted.size(), (TaskPool *) NULL);
+    EXPECT_EQ(expected, sorted);
+    TaskPool pool(4);
+    sorted = pontos;
+    radixSort<RadixKeyYX>(sorted.data(), sorted.size(), &pool);
+    EXPECT_EQ(expected, sorted);
+
+    vector<PointI> ints;
+    for (int i = 0; i < 20000; i++)
+        ints.push_back(PointI((int32_t) gen() % 1000, (int32_t) gen()));
+    vector<PointI> expectedI = ints;
+    sort(expectedI.begin(), expectedI.end(), [](const PointI &p, const PointI &q) {
+        return p.x < q.x || (p.x == q.x && p.y < q.y);
+    });
+    radixSort<RadixKeyInt>(ints.data(), ints.size(), &pool);
+    EXPECT_EQ(expectedI, ints);
+}
+
+
+TEST(CAL_FP03, testNP_MultiProcess) {
+    vector<Point> pontos;
+    readPoints("Pontos16k", pontos);
+    MultiProcessStats stats;
+    Result res = nearestPoints_MultiProcess(pontos, 4, &stats);
+    EXPECT_NEAR(13.0384, res.dmin, 0.01);
+    EXPECT_EQ(res.dmin, res.p1.distance(res.p2));
+    ASSERT_EQ(4, (int) stats.workers.size());
+    int points = 0;
+    size_t bytes = 0;
+    for (size_t w = 0; w < stats.workers.size(); w++) {
+        EXPECT_FALSE(stats.workers[w].failed);
+        EXPECT_LE(stats.workers[w].stripPoints, stats.workers[w].points);
+        points += stats.workers[w].points;
+        bytes += stats.workers[w].bytesSent;
+    }
+    EXPECT_EQ((int) pontos.size(), points);
+    EXPECT_EQ(bytes, stats.bytesExchanged);
+    EXPECT_LT(stats.bytesExchanged, stats.bytesDistributed / 4);
+
+    // The closest pair across a slab boundary, and slabs of equal X
+    pontos.clear();
+    for (int i = 0; i < 1000; i++)
+        pontos.push_back(Point(i * 10, i % 2));
+    pontos.push_back(Point(2494, 1));
+    EXPECT_EQ(4.0, nearestPoints_MultiProcess(pontos, 4).dmin);
+    generateRandomConstX(3000, pontos, 45);
+    vector<Point> copy = pontos;
+    EXPECT_EQ(nearestPoints_DC_Merge(copy).dmin, nearestPoints_MultiProcess(pontos, 3).dmin);
+}
+
+
+TEST(CAL_FP03, testNP_Approx) {
+    vector<Point> pontos, copy;
+    readPoints("Pontos16k", pontos);
+    EXPECT_EQ(0.01, getApproxEpsilon());
+    EXPECT_NEAR(13.0384, nearestPoints_Approx(pontos).dmin, 0.01 * 13.0384);
+
+    // The bounds hold on spread, aligned, clustered and repeated points
+    vector<vector<Point> > sets(4);
+    generateRandom(20000, sets[0], 46);
+    generateRandomConstX(20000, sets[1], 46);
+    for (int i = 0; i < 20000; i++)
+        sets[2].push_back(Point((i % 2 ? 1e9 : 0) + i / 2 % 100 * 0.5, i / 200 * 0.5));
+    for (int i = 0; i < 100; i++)
+        sets[3].push_back(Point(5, 5));
+    for (size_t s = 0; s < sets.size(); s++) {
+        copy = sets[s];
+        double exact = nearestPoints_DC_Merge(copy).dmin;
+        ApproxResult res = nearestPoints_ApproxBound(sets[s], 0.01);
+        EXPECT_EQ(res.pair.dmin, res.pair.p1.distance(res.pair.p2));
+        EXPECT_LE(res.lowerBound, exact);
+        EXPECT_LE(exact, res.pair.dmin);
+        EXPECT_LE(res.pair.dmin, 1.01 * res.lowerBound);
+    }
+
+    // A lattice of unit spacing: cells of 199 / 200 are accepted within 1%, not 0.1%
+    vector<Point> lattice;
+    for (int i = 0; i < 200 * 200; i++)
+        lattice.push_back(Point(i % 200, i / 200));
+    ApproxResult res = nearestPoints_ApproxBound(lattice, 0.01);
+    EXPECT_EQ(1.0, res.pair.dmin);
+    EXPECT_NEAR(0.995, res.lowerBound, 1e-9);
+    res = nearestPoints_ApproxBound(lattice, 0.001);
+    EXPECT_EQ(1.0, res.lowerBound);
+}
+
+
+TEST(CAL_FP03, testPointSetIndex) {
+    vector<Point> pontos;
+    readPoints("Pontos16k", pontos);
+    PointSetIndex index(pontos);
+    EXPECT_NEAR(13.0384, index.closest().dmin, 0.01);
+    EXPECT_EQ(index.closest().dmin, index.closest_MT().dmin);
+
+    // The cached orders
+    const vector<int> &byX = index.orderByX();
+    for (size_t k = 1; k < byX.size(); k++)
+        EXPECT_LE(pontos[byX[k - 1]].x, pontos[byX[k]].x);
+    const vector<int> &byY = index.orderByY();
+    for (size_t k = 1; k < byY.size(); k++)
+        EXPECT_LE(pontos[byY[k - 1]].y, pontos[byY[k]].y);
+
+    // Ranges of X, small (sorted) and large (filtered), against the points in them
+    double ranges[][2] = {{0, 1000}, {100, 200}, {-1e9, 1e9}, {5000, 1e9}, {3000, 3000}};
+    for (int r = 0; r < 5; r++) {
+        vector<Point> subset;
+        for (size_t i = 0; i < pontos.size(); i++)
+            if (pontos[i].x >= ranges[r][0] && pontos[i].x <= ranges[r][1])
+                subset.push_back(pontos[i]);
+        Result res = index.closestInRange(ranges[r][0], ranges[r][1]);
+        if (subset.size() < 2)
+            EXPECT_EQ(Result().dmin, res.dmin);
+        else {
+            EXPECT_EQ(nearestPoints_DC_Merge(subset).dmin, res.dmin);
+            EXPECT_EQ(res.dmin, res.p1.distance(res.p2));
+        }
+    }
+
+    // Changes invalidate the orders
+    Point p = pontos[byX[100]];
+    int added = index.add(Point(p.x + 1, p.y));
+    EXPECT_EQ((int) pontos.size(), added);
+    EXPECT_EQ(1.0, index.closest().dmin);
+    index.set(added, Point(p.x + 0.5, p.y));
+    EXPECT_EQ(0.5, index.closest().dmin);
+    EXPECT_EQ(0.5, index.closestInRange(p.x, p.x + 1).dmin);
+    EXPECT_EQ(Result().dmin, index.closestInRange(p.x + 0.6, p.x + 0.6).dmin);
+}
+
+
+TEST(CAL_FP03, testSpaceFillingCurve) {
+    // x = 011, y = 101: bits interleaved from x
+    EXPECT_EQ(39u, mortonKey(3, 5));
+
+    // The cells of a 16 x 16 corner are visited once each, each next to the previous one
+    vector<pair<int, int> > cells(256, make_pair(-1, -1));
+    for (int x = 0; x < 16; x++)
+        for (int y = 0; y < 16; y++) {
+            uint32_t key = hilbertKey(x, y);
+            ASSERT_LT(key, 256u);
+            cells[key] = make_pair(x, y);
+        }
+    EXPECT_EQ(make_pair(0, 0), cells[0]);
+    for (int k = 1; k < 256; k++)
+        EXPECT_EQ(1, abs(cells[k].first - cells[k - 1].first) + abs(cells[k].second - cells[k - 1].second));
+
+    // Reordering keeps the points and the answers, sequentially and in parallel
+    vector<Point> pontos;
+    generateRandom(200000, pontos, 48);
+    auto lessXY = [](const Point &p, const Point &q) { return p.x < q.x || (p.x == q.x && p.y < q.y); };
+    vector<Point> sorted = pontos;
+    sort(sorted.begin(), sorted.end(), lessXY);
+    CurveOrder orders[] = {CURVE_MORTON, CURVE_HILBERT};
+    TaskPool pool(4);
+    for (CurveOrder order : orders) {
+        vector<Point> copy = pontos;
+        sortByCurve(copy, order, NULL);
+        vector<Point> copyMT = pontos;
+        sortByCurve(copyMT, order, &pool);
+        EXPECT_EQ(copy, copyMT);
+        EXPECT_EQ(nearestPoints_Approx(copy).dmin, nearestPoints_Approx(copyMT).dmin);
+        sort(copy.begin(), copy.end(), lessXY);
+        EXPECT_EQ(sorted, copy);
+    }
+}
+
+
+TEST(CAL_FP03, testNP_BF_SmallSets) {
+    // Every remainder of the vector width, and sets around the base case of the divide and conquer
+    mt19937 gen(49);
+    uniform_real_distribution<double> dis(-1000, 1000);
+    int sizes[] = {2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 127, 129, 255, 257, 600};
+    for (int n : sizes) {
+        vector<Point> pontos;
+        for (int i = 0; i < n; i++)
+            pontos.push_back(Point(dis(gen), dis(gen)));
+        vector<Point> copy = pontos;
+        double expected = nearestPoints_DC_Merge(copy).dmin;
+        copy = pontos;
+        Result res = nearestPoints_BF(copy);
+        EXPECT_EQ(expected, res.dmin);
+        EXPECT_EQ(res.dmin, res.p1.distance(res.p2));
+        copy = pontos;
+        EXPECT_EQ(expected, nearestPoints_BF_SortByX(copy).dmin);
+        copy = pontos;
+        EXPECT_EQ(expected, nearestPoints_DC(copy).dmin);
+    }
+    vector<Point> single(1, Point(1, 1));
+    EXPECT_EQ(Result().dmin, nearestPoints_BF(single).dmin);
+}
+
+
+TEST(CAL_FP03, testNP_Batch) {
+    // Sets of every size up to 600 (both methods), empty and single point sets,
+    // with integer and with non-integer coordinates
+    mt19937 gen(50);
+    uniform_int_distribution<int> dis(-5000, 5000);
+    uniform_real_distribution<double> disReal(-1000, 1000);
+    vector<Point> points;
+    vector<size_t> offsets(1, 0);
+    for (int n = 0; n <= 600; n += (n < 20 ? 1 : 17)) {
+        for (int i = 0; i < n; i++)
+            points.push_back(Point(dis(gen), dis(gen)));
+        offsets.push_back(points.size());
+        for (int i = 0; i < n; i++)
+            points.push_back(Point(disReal(gen), disReal(gen)));
+        offsets.push_back(points.size());
+    }
+    int numSets = offsets.size() - 1;
+    vector<Result> results(numSets), resultsMT(numSets);
+    nearestPoints_Batch(points.data(), offsets.data(), numSets, results.data());
+    setNumThreads(4);
+    nearestPoints_Batch_MT(points.data(), offsets.data(), numSets, resultsMT.data());
+    setNumThreads(1);
+    for (int s = 0; s < numSets; s++) {
+        vector<Point> set(points.begin() + offsets[s], points.begin() + offsets[s + 1]);
+        double expected = nearestPoints_DC_Merge(set).dmin;
+        EXPECT_EQ(expected, results[s].dmin);
+        EXPECT_EQ(expected, resultsMT[s].dmin);
+        if (set.size() >= 2) {
+            EXPECT_EQ(results[s].dmin, results[s].p1.distance(results[s].p2));
+        }
+    }
+    nearestPoints_Batch_MT(points.data(), offsets.data(), 0, NULL);
+}
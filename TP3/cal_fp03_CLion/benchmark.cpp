@@ -0,0 +1,399 @@
+/*
+ * benchmark.cpp
+ *
+ * Times every closest pair algorithm on every data set: the Pontos files
+ * and the generated Pontos*M / *ConstX sets. Each measure is the median and
+ * 95th percentile of several repetitions, after warmup runs; the _MT
+ * variants are run with 1 to N threads, with their parallel efficiency
+ * relative to 1 thread.
+ * Usage: CAL_FP03_Benchmark [--format csv|json] [--reps R] [--warmup W]
+ *            [--threads N] [--bf-max M] [--epsilon E] [--processes K]
+ *            [--curve morton|hilbert] [data set ...]
+ * The approximate algorithm runs with epsilon E (default 0.01).
+ * With --curve, every data set is reordered along that space-filling curve
+ * (timed as an algorithm of its own) before the algorithms run on it.
+ * Brute force only runs on sets of up to M points (default 32768). Data set
+ * names restrict the run to those sets. Files are read from the current
+ * directory: a Pontos file with a binary version <name>.bin (made with
+ * CAL_FP03_Convert) is mapped from that one instead of parsed, and the
+ * divide and conquer algorithms merging by y also run straight on the
+ * mapped file, with the mapping timed as part of the algorithm.
+ * With --processes K, only nearestPoints_MultiProcess is run, with 1 to K
+ * worker processes, and each worker's slab size, strip, bytes sent and
+ * times are reported (one row per worker) to extrapolate to a cluster.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <cstdlib>
+#include <cmath>
+
+#include "Tests/NearestPoints.h"
+#include "Tests/PointFile.h"
+#include "Tests/PointGenerator.h"
+#include "Tests/MultiProcessNearestPoints.h"
+#include "Tests/ApproxNearestPoints.h"
+#include "Tests/SpaceFillingCurve.h"
+
+using namespace std;
+
+static const unsigned SEED = 2020;
+
+struct DataSet {
+	string name;
+	int size;     // points to generate, 0 for a file
+	bool constX;
+};
+
+struct Algorithm {
+	string name;
+	NP_FUNC func;
+	bool multiThreaded;
+	bool quadratic;
+};
+
+struct MappedAlgorithm {
+	string name;
+	Result (*func)(const PointSoA &points);
+	bool multiThreaded;
+};
+
+struct Record {
+	string algorithm, dataSet;
+	int points, threads;
+	double medianMs, p95Ms, minMs;
+	double pointsPerSec;
+	double efficiency; // < 0 if not applicable
+	double dmin;       // < 0 for a reordering
+};
+
+static double elapsedMs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Nearest-rank percentile of sorted times.
+ */
+static double percentile(const vector<double> &sorted, double p)
+{
+	size_t rank = (size_t) ceil(p / 100 * sorted.size());
+	return sorted[max(rank, (size_t) 1) - 1];
+}
+
+/**
+ * Record of a measure, from the times of its runs (sorted here).
+ */
+static Record makeRecord(const string &algorithm, const string &dataSet, int points, int threads,
+		vector<double> &times, const Result &res)
+{
+	sort(times.begin(), times.end());
+
+	Record rec;
+	rec.algorithm = algorithm;
+	rec.dataSet = dataSet;
+	rec.points = points;
+	rec.threads = threads;
+	rec.medianMs = times.size() % 2 ? times[times.size() / 2]
+			: (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+	rec.p95Ms = percentile(times, 95);
+	rec.minMs = times[0];
+	rec.pointsPerSec = rec.medianMs > 0 ? points / (rec.medianMs / 1000) : 0;
+	rec.efficiency = -1;
+	rec.dmin = res.dmin;
+	return rec;
+}
+
+static Record measure(const Algorithm &alg, const string &dataSet, const vector<Point> &points,
+		int threads, int warmup, int reps)
+{
+	vector<double> times;
+	vector<Point> vp;
+	Result res;
+	for (int r = 0; r < warmup + reps; r++)
+	{
+		vp = points; // the algorithms reorder the points
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		res = alg.func(vp);
+		double ms = elapsedMs(start);
+		if (r >= warmup)
+			times.push_back(ms);
+	}
+	return makeRecord(alg.name, dataSet, points.size(), threads, times, res);
+}
+
+/**
+ * Same as measure, mapping the binary point file "file" on every run.
+ */
+static Record measureMapped(const MappedAlgorithm &alg, const string &dataSet, const string &file,
+		int threads, int warmup, int reps)
+{
+	vector<double> times;
+	Result res;
+	int n = 0;
+	for (int r = 0; r < warmup + reps; r++)
+	{
+		PointSoA points;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (loadPointFile(file, points))
+			res = alg.func(points);
+		double ms = elapsedMs(start);
+		n = points.size();
+		if (r >= warmup)
+			times.push_back(ms);
+	}
+	return makeRecord(alg.name, dataSet, n, threads, times, res);
+}
+
+static Result reorderMorton(vector<Point> &vp)
+{
+	sortByCurve(vp, CURVE_MORTON, getPool());
+	Result res;
+	res.dmin = -1;
+	return res;
+}
+
+static Result reorderHilbert(vector<Point> &vp)
+{
+	sortByCurve(vp, CURVE_HILBERT, getPool());
+	Result res;
+	res.dmin = -1;
+	return res;
+}
+
+static void printCSVHeader()
+{
+	cout << "algorithm,data set,points,threads,median (ms),p95 (ms),min (ms),points/sec,efficiency,distance" << endl;
+}
+
+static void printCSV(const Record &r)
+{
+	cout << "\"" << r.algorithm << "\"," << r.dataSet << "," << r.points << "," << r.threads << ","
+		 << r.medianMs << "," << r.p95Ms << "," << r.minMs << "," << r.pointsPerSec << ",";
+	if (r.efficiency >= 0)
+		cout << r.efficiency;
+	cout << "," << r.dmin << endl;
+}
+
+static void printJSON(const vector<Record> &records)
+{
+	cout << "[" << endl;
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		const Record &r = records[i];
+		cout << "  {\"algorithm\": \"" << r.algorithm << "\", \"dataSet\": \"" << r.dataSet
+			 << "\", \"points\": " << r.points << ", \"threads\": " << r.threads
+			 << ", \"medianMs\": " << r.medianMs << ", \"p95Ms\": " << r.p95Ms << ", \"minMs\": " << r.minMs
+			 << ", \"pointsPerSec\": " << r.pointsPerSec << ", \"efficiency\": ";
+		if (r.efficiency >= 0)
+			cout << r.efficiency;
+		else
+			cout << "null";
+		cout << ", \"distance\": " << r.dmin << "}" << (i + 1 < records.size() ? "," : "") << endl;
+	}
+	cout << "]" << endl;
+}
+
+/**
+ * Measures with 1 thread, or 1 to maxThreads if multiThreaded (with the
+ * parallel efficiency relative to 1 thread), by measureOne(threads).
+ */
+template <class Measure>
+static void measureThreads(bool multiThreaded, int maxThreads, const Measure &measureOne,
+		vector<Record> &records, bool json)
+{
+	int threads = multiThreaded ? maxThreads : 1;
+	double baseline = 0;
+	for (int t = 1; t <= threads; t++)
+	{
+		setNumThreads(t);
+		Record rec = measureOne(t);
+		if (multiThreaded)
+		{
+			if (t == 1)
+				baseline = rec.medianMs;
+			rec.efficiency = rec.medianMs > 0 ? baseline / (t * rec.medianMs) : 0;
+		}
+		records.push_back(rec);
+		if (!json)
+			printCSV(rec);
+	}
+}
+
+/**
+ * Runs nearestPoints_MultiProcess with 1 to maxProcesses workers, printing
+ * one row per worker, and one for the coordinator (worker -1) with the
+ * totals, its merge time as solve time and the whole run as total time.
+ */
+static void measureProcesses(const string &dataSet, const vector<Point> &points, int maxProcesses,
+		bool json, bool &firstRow)
+{
+	for (int k = 1; k <= maxProcesses; k++)
+	{
+		vector<Point> vp = points;
+		MultiProcessStats st;
+		Result res = nearestPoints_MultiProcess(vp, k, &st);
+		for (int w = -1; w < (int) st.workers.size(); w++)
+		{
+			WorkerStats ws = w < 0 ? WorkerStats() : st.workers[w];
+			if (w < 0)
+			{
+				ws.points = points.size();
+				for (size_t j = 0; j < st.workers.size(); j++)
+					ws.stripPoints += st.workers[j].stripPoints;
+				ws.bytesSent = st.bytesExchanged;
+				ws.solveMs = st.mergeMs;
+				ws.totalMs = st.totalMs;
+			}
+			if (json)
+				cout << (firstRow ? "  " : ", ") << "{\"dataSet\": \"" << dataSet << "\", \"processes\": " << k
+					 << ", \"worker\": " << w << ", \"points\": " << ws.points
+					 << ", \"stripPoints\": " << ws.stripPoints << ", \"bytesSent\": " << ws.bytesSent
+					 << ", \"solveMs\": " << ws.solveMs << ", \"totalMs\": " << ws.totalMs
+					 << ", \"failed\": " << (ws.failed ? "true" : "false") << ", \"distance\": " << res.dmin << "}" << endl;
+			else
+				cout << dataSet << "," << k << "," << w << "," << ws.points << "," << ws.stripPoints << ","
+					 << ws.bytesSent << "," << ws.solveMs << "," << ws.totalMs << "," << ws.failed << ","
+					 << res.dmin << endl;
+			firstRow = false;
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool json = false;
+	int reps = 5, warmup = 1, bfMax = 32768, maxProcesses = 0;
+	int maxThreads = max(1u, thread::hardware_concurrency());
+	CurveOrder curve = CURVE_NONE;
+	vector<string> only;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--format" && hasValue)
+			json = string(argv[++i]) == "json";
+		else if (arg == "--reps" && hasValue)
+			reps = max(1, atoi(argv[++i]));
+		else if (arg == "--warmup" && hasValue)
+			warmup = max(0, atoi(argv[++i]));
+		else if (arg == "--threads" && hasValue)
+			maxThreads = max(1, atoi(argv[++i]));
+		else if (arg == "--bf-max" && hasValue)
+			bfMax = atoi(argv[++i]);
+		else if (arg == "--epsilon" && hasValue)
+			setApproxEpsilon(atof(argv[++i]));
+		else if (arg == "--processes" && hasValue)
+			maxProcesses = max(1, atoi(argv[++i]));
+		else if (arg == "--curve" && hasValue)
+		{
+			string name = argv[++i];
+			if (name != "morton" && name != "hilbert")
+			{
+				cerr << "Unknown curve " << name << endl;
+				return 1;
+			}
+			curve = name == "morton" ? CURVE_MORTON : CURVE_HILBERT;
+		}
+		else if (arg.compare(0, 2, "--") == 0)
+		{
+			cerr << "Unknown option " << arg << endl;
+			return 1;
+		}
+		else
+			only.push_back(arg);
+	}
+
+	const DataSet dataSets[] = {
+		{"Pontos8", 0, false}, {"Pontos64", 0, false}, {"Pontos1k", 0, false},
+		{"Pontos16k", 0, false}, {"Pontos32k", 0, false}, {"Pontos64k", 0, false},
+		{"Pontos128k", 0, false},
+		{"Pontos256k", 0x40000, false}, {"Pontos512k", 0x80000, false},
+		{"Pontos1M", 0x100000, false}, {"Pontos2M", 0x200000, false},
+		{"Pontos32kConstX", 0x8000, true}, {"Pontos64kConstX", 0x10000, true},
+		{"Pontos128kConstX", 0x20000, true}, {"Pontos256kConstX", 0x40000, true},
+		{"Pontos512kConstX", 0x80000, true}, {"Pontos1MConstX", 0x100000, true},
+		{"Pontos2MConstX", 0x200000, true}
+	};
+	const Algorithm algorithms[] = {
+		{"Brute force", nearestPoints_BF, false, true},
+		{"Brute force, sorted by x", nearestPoints_BF_SortByX, false, true},
+		{"Divide and conquer", nearestPoints_DC, false, false},
+		{"Divide and conquer, merging by y", nearestPoints_DC_Merge, false, false},
+		{"Randomized grid hashing", nearestPoints_Grid, false, false},
+		{"Approximate, grid of about one point per cell", nearestPoints_Approx, false, false},
+		{"Divide and conquer MT", nearestPoints_DC_MT, true, false},
+		{"Divide and conquer, merging by y, MT", nearestPoints_DC_Merge_MT, true, false}
+	};
+
+	const MappedAlgorithm mappedAlgorithms[] = {
+		{"Divide and conquer, merging by y, on the mapped file", nearestPoints_DC_Merge, false},
+		{"Divide and conquer, merging by y, MT, on the mapped file", nearestPoints_DC_Merge_MT, true}
+	};
+
+	const Algorithm reorderings[] = {
+		{"Reordering by Morton curve", reorderMorton, true, false},
+		{"Reordering by Hilbert curve", reorderHilbert, true, false}
+	};
+
+	vector<Record> records;
+	bool firstRow = true;
+	if (maxProcesses > 0)
+		cout << (json ? "[" : "data set,processes,worker,points,strip points,bytes sent,solve (ms),total (ms),failed,distance") << endl;
+	else if (!json)
+		printCSVHeader();
+	for (const DataSet &ds : dataSets)
+	{
+		if (!only.empty() && find(only.begin(), only.end(), ds.name) == only.end())
+			continue;
+		vector<Point> points;
+		string binaryFile = ds.name + ".bin";
+		PointSoA mapped;
+		bool isMapped = ds.size == 0 && loadPointFile(binaryFile, mapped);
+		if (isMapped)
+			mapped.toVector(points);
+		else if (ds.size == 0)
+		{
+			if (!readPointText(ds.name, points))
+			{
+				cerr << "Skipping " << ds.name << ": can't read the file" << endl;
+				continue;
+			}
+		}
+		else if (ds.constX)
+			generateRandomConstX(ds.size, points, SEED);
+		else
+			generateRandom(ds.size, points, SEED);
+		if (maxProcesses > 0)
+		{
+			measureProcesses(ds.name, points, maxProcesses, json, firstRow);
+			continue;
+		}
+
+		vector<Algorithm> toRun(begin(algorithms), end(algorithms));
+		if (curve != CURVE_NONE)
+			toRun.insert(toRun.begin(), reorderings[curve == CURVE_MORTON ? 0 : 1]);
+		for (const Algorithm &alg : toRun)
+		{
+			if (alg.quadratic && (int) points.size() > bfMax)
+				continue;
+			measureThreads(alg.multiThreaded, maxThreads,
+					[&](int t) { return measure(alg, ds.name, points, t, warmup, reps); }, records, json);
+			if (curve != CURVE_NONE && &alg == &toRun[0])
+				sortByCurve(points, curve, getPool());
+		}
+		if (isMapped && curve == CURVE_NONE)
+			for (const MappedAlgorithm &alg : mappedAlgorithms)
+				measureThreads(alg.multiThreaded, maxThreads,
+						[&](int t) { return measureMapped(alg, ds.name, binaryFile, t, warmup, reps); }, records, json);
+	}
+	if (maxProcesses > 0 && json)
+		cout << "]" << endl;
+	else if (json)
+		printJSON(records);
+	return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * convert.cpp
+ *
+ * Converts text point files ("x y" pairs, as the Pontos files) to the
+ * binary point file format (see Tests/PointFile.h).
+ * Usage: CAL_FP03_Convert input output [input output ...]
+ */
+
+#include <iostream>
+#include "Tests/PointFile.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3 || argc % 2 == 0)
+	{
+		cerr << "Usage: " << argv[0] << " input output [input output ...]" << endl;
+		return 1;
+	}
+	int failures = 0;
+	for (int i = 1; i + 1 < argc; i += 2)
+		if (!convertPointFile(argv[i], argv[i + 1]))
+		{
+			cerr << "Failed to convert " << argv[i] << " to " << argv[i + 1] << endl;
+			failures++;
+		}
+	return failures == 0 ? 0 : 1;
+}